@@ -0,0 +1,102 @@
+//
+// Sparse boolean matrices over the vertices of a graph.
+//
+
+#ifndef QS_BOOLMATRIX_H
+#define QS_BOOLMATRIX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Estimator.h"
+#include "SimpleGraph.h"
+#include "WorkStealingPool.h"
+
+// A square boolean matrix stored by its non-empty rows. A row is a sorted list of column ids while it is
+// sparse and switches to a bitset over all columns once it holds at least 1/DENSE_ROW_RATIO of them, where
+// the bitset takes no more memory than the list. Products OR the rows of the right operand into a bitset
+// accumulator, so a dense row is merged a machine word at a time and duplicates never arise.
+class BoolMatrix {
+
+public:
+
+    static const uint32_t DENSE_ROW_RATIO = 32;
+
+    struct Row {
+        std::vector<uint32_t> columns;
+        // all columns as a bitset if the row is dense, empty otherwise
+        std::vector<uint64_t> bits;
+        uint32_t count = 0;
+
+        bool isDense() const { return !bits.empty(); }
+    };
+
+private:
+
+    uint32_t n;
+    // ids of the non-empty rows in ascending order, and the rows themselves
+    std::vector<uint32_t> rowIds;
+    std::vector<Row> rows;
+    // position of every vertex's row (UINT32_MAX if empty) once indexRows() was called, else empty
+    std::vector<uint32_t> slots;
+
+    static bool isDense(uint32_t count, uint32_t n) { return uint64_t(count) * DENSE_ROW_RATIO >= n; }
+
+    // turns the marks of an accumulator into a row, and clears them; touched lists the marked columns
+    // unless the accumulator was filled word-wide, in which case all of its words are scanned
+    static void takeRow(std::vector<uint64_t> &accumulator, std::vector<uint32_t> &touched, bool scan,
+                        uint32_t n, Row &row);
+    // joins matrices that hold consecutive ranges of rows
+    static BoolMatrix concatenate(std::vector<BoolMatrix> &parts, uint32_t n);
+
+public:
+
+    explicit BoolMatrix(uint32_t noVertices = 0) : n(noVertices) {}
+
+    // the relation of a CSR index, optionally only its row of one source
+    static BoolMatrix fromIndex(const AdjacencyIndex &index, uint32_t noVertices, uint32_t source = ANY_VERTEX);
+
+    uint32_t size() const { return n; }
+    uint32_t noRows() const { return static_cast<uint32_t>(rowIds.size()); }
+    uint32_t rowId(uint32_t i) const { return rowIds[i]; }
+    const Row &row(uint32_t i) const { return rows[i]; }
+    // the row of a vertex, or nullptr if it is empty
+    const Row *find(uint32_t id) const;
+    // makes find() a direct lookup instead of a binary search, for matrices that are probed often
+    void indexRows();
+
+    // appends a row; ids must be appended in ascending order, and empty rows are dropped
+    void append(uint32_t id, Row &&row);
+
+    // calls f(column) for every column of a row, in ascending order
+    template <typename F>
+    static void forEachColumn(const Row &row, F f) {
+        if (!row.isDense()) {
+            for (auto column : row.columns) f(column);
+            return;
+        }
+        for (size_t w = 0; w < row.bits.size(); ++w) {
+            for (uint64_t word = row.bits[w]; word != 0; word &= word - 1) {
+                f(static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+    // the columns that occur in any row, in ascending order
+    std::vector<uint32_t> columnIds() const;
+    // {non-empty rows, set entries, non-empty columns}
+    cardStat stats() const;
+
+    // keeps only the rows with the column set, reduced to that single entry
+    void restrictToColumn(uint32_t column);
+
+    // the boolean product a x b, with the rows of a split into morsels on the pool if one is given
+    static BoolMatrix multiply(const BoolMatrix &a, const BoolMatrix &b, WorkStealingPool *pool = nullptr);
+
+    // rows of the transitive closure (reflexive-transitive if reflexive is set) for the given sources in
+    // ascending order, traversed 64 sources at a time; without sources, every vertex that can start a path
+    BoolMatrix closure(bool reflexive, const std::vector<uint32_t> *sources = nullptr,
+                       WorkStealingPool *pool = nullptr) const;
+};
+
+#endif //QS_BOOLMATRIX_H
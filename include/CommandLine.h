@@ -0,0 +1,23 @@
+//
+// Parsing shared by the command line tools.
+//
+
+#ifndef QS_COMMANDLINE_H
+#define QS_COMMANDLINE_H
+
+#include <memory>
+#include <string>
+
+#include "SimpleEstimator.h"
+#include "SimpleGraph.h"
+
+// "*" leaves a query endpoint unbound, anything else binds it to that vertex (by its id in the graph file);
+// throws on anything but "*" or a vertex id
+uint32_t parseEndpoint(const std::string &endpoint, const SimpleGraph &g);
+
+// the estimator called name: sampling or markov
+std::shared_ptr<SimpleEstimator> makeEstimator(const std::string &name, std::shared_ptr<SimpleGraph> &g);
+// whether makeEstimator knows name, to reject it before a graph is read
+bool isEstimator(const std::string &name);
+
+#endif //QS_COMMANDLINE_H
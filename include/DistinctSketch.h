@@ -0,0 +1,33 @@
+//
+// HyperLogLog sketch of the number of distinct vertices in a set.
+//
+
+#ifndef QS_DISTINCTSKETCH_H
+#define QS_DISTINCTSKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DistinctSketch {
+
+    uint32_t precision;
+    std::vector<uint8_t> registers;
+
+public:
+
+    // 2^precision one-byte registers, relative error about 1.04 / sqrt(2^precision)
+    explicit DistinctSketch(uint32_t precision = 12);
+
+    void add(uint32_t vertex);
+    // union with a sketch of the same precision
+    void merge(const DistinctSketch &other);
+    void clear();
+
+    double estimate() const;
+
+    // heap bytes of the registers
+    size_t memoryUsage() const { return registers.capacity(); }
+};
+
+#endif //QS_DISTINCTSKETCH_H
@@ -8,6 +8,9 @@
 #include "RPQTree.h"
 #include <iostream>
 
+// vertex id of an unbound ('*') query endpoint
+const uint32_t ANY_VERTEX = UINT32_MAX;
+
 struct cardStat {
     uint32_t noOut;
     uint32_t noPaths;
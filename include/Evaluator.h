@@ -13,8 +13,12 @@
 class Evaluator {
 
 public:
+    virtual ~Evaluator() = default;
+
     virtual void prepare() = 0;
     virtual cardStat evaluate(RPQTree *query) = 0;
+    // evaluate with bound endpoints (or ANY_VERTEX)
+    virtual cardStat evaluate(RPQTree *query, uint32_t source, uint32_t target) = 0;
 
 };
 
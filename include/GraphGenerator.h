@@ -0,0 +1,91 @@
+//
+// Deterministic synthetic graphs and path queries for benchmarking.
+//
+
+#ifndef QS_GRAPHGENERATOR_H
+#define QS_GRAPHGENERATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "SimpleGraph.h"
+
+// the degree distributions the generator produces
+enum class GraphShape {
+    // endpoints and labels drawn uniformly
+    uniform,
+    // endpoints drawn with a heavy-tailed (power-law like) degree, labels skewed towards the first ones
+    powerLaw,
+    // uniform, but for a small set of hubs that take part in half of all edges
+    hubs
+};
+
+struct GraphSpec {
+    GraphShape shape = GraphShape::powerLaw;
+    uint32_t noVertices = 1000000;
+    uint64_t noEdges = 10000000;
+    uint32_t noLabels = 16;
+    uint64_t seed = 1;
+};
+
+struct QuerySpec {
+    uint32_t noQueries = 100;
+    uint32_t minLength = 1;
+    uint32_t maxLength = 3;
+    // fractions of steps walked backwards, of queries with a bound endpoint, and of those ending in a closure
+    double inverseRate = 0.25;
+    double boundRate = 0.3;
+    double closureRate = 0.3;
+    uint64_t seed = 1;
+};
+
+// a query in the format of the workload files: source, path and target, '*' for unbound endpoints
+struct GeneratedQuery {
+    std::string source;
+    std::string path;
+    std::string target;
+};
+
+// splitmix64, with its own distributions, so a seed gives the same graph on every platform and standard library
+class SplitMix64 {
+    uint64_t state;
+
+public:
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    // uniform in [0, 1)
+    double unit() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+    // uniform in [0, n)
+    uint32_t below(uint32_t n) { return static_cast<uint32_t>(((next() >> 32) * n) >> 32); }
+};
+
+class GraphGenerator {
+    GraphSpec spec;
+
+public:
+    explicit GraphGenerator(const GraphSpec &spec);
+
+    // every edge as (source, label, target), always in the same order; duplicates are possible
+    void forEachEdge(const std::function<void(uint32_t, uint32_t, uint32_t)> &edge) const;
+    // in the text format readFromContiguousFile reads
+    void writeText(const std::string &fileName) const;
+    // adds the edges and builds the indexes
+    void fill(SimpleGraph &g) const;
+
+    static GraphShape parseShape(const std::string &name);
+    static std::string shapeName(GraphShape shape);
+};
+
+// random walks over the graph's indexes, so that every query has at least one match; bound endpoints are the
+// walk's own, in the ids of the input
+std::vector<GeneratedQuery> generateQueries(const SimpleGraph &g, const QuerySpec &spec);
+
+#endif //QS_GRAPHGENERATOR_H
@@ -0,0 +1,70 @@
+//
+// Intermediate results of query evaluation.
+//
+
+#ifndef QS_INTERMEDIATE_H
+#define QS_INTERMEDIATE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// source => sorted, duplicate-free destinations, stored flat: the sources in ascending order, and the
+// destinations of sources[i] at targets[offsets[i]] .. targets[offsets[i+1]-1] of one shared buffer.
+// A result takes three allocations however many sources it has, and is released in one go. The offsets are
+// 32 bits wide, like those of the graph: a result of more than UINT32_MAX pairs is rejected.
+struct intermediate {
+    std::vector<uint32_t> sources;
+    std::vector<uint32_t> offsets {0};
+    std::vector<uint32_t> targets;
+
+    size_t size() const { return sources.size(); }
+    bool empty() const { return sources.empty(); }
+
+    // destinations of the i-th source
+    uint32_t degree(size_t i) const { return offsets[i + 1] - offsets[i]; }
+    const uint32_t *begin(size_t i) const { return targets.data() + offsets[i]; }
+    const uint32_t *end(size_t i) const { return targets.data() + offsets[i + 1]; }
+
+    // position of a source, or size() if it has no destinations
+    size_t find(uint32_t source) const {
+        auto position = std::lower_bound(sources.begin(), sources.end(), source);
+        if (position == sources.end() || *position != source) return size();
+        return position - sources.begin();
+    }
+
+    void checkSize() const {
+        if (targets.size() > UINT32_MAX) {
+            throw std::runtime_error("Intermediate result exceeds " + std::to_string(UINT32_MAX) + " paths!");
+        }
+    }
+
+    // adds the destinations of a source greater than every source so far; an empty list is dropped
+    void append(uint32_t source, const uint32_t *first, const uint32_t *last) {
+        if (first == last) return;
+        sources.push_back(source);
+        targets.insert(targets.end(), first, last);
+        checkSize();
+        offsets.push_back(static_cast<uint32_t>(targets.size()));
+    }
+
+    // adds all sources of other, which must be greater than every source so far
+    void append(const intermediate &other) {
+        const uint32_t shift = static_cast<uint32_t>(targets.size());
+        sources.insert(sources.end(), other.sources.begin(), other.sources.end());
+        targets.insert(targets.end(), other.targets.begin(), other.targets.end());
+        checkSize();
+        for (size_t i = 1; i < other.offsets.size(); ++i) {
+            offsets.push_back(other.offsets[i] + shift);
+        }
+    }
+};
+
+// heap footprint of an intermediate
+inline size_t memoryUsage(const intermediate &result) {
+    return sizeof(intermediate) + (result.sources.capacity() + result.offsets.capacity() + result.targets.capacity()) * sizeof(uint32_t);
+}
+
+#endif //QS_INTERMEDIATE_H
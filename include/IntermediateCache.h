@@ -0,0 +1,70 @@
+//
+// Byte-bounded, thread-safe cache of intermediate results.
+//
+
+#ifndef QS_INTERMEDIATECACHE_H
+#define QS_INTERMEDIATECACHE_H
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "Intermediate.h"
+
+// Evicts by GreedyDual-Size: an entry's priority is the cache's clock plus its recomputation cost per
+// byte, refreshed on every hit. The entry with the lowest priority goes first, and the clock advances
+// to its priority, so entries that are cheap to recompute for their size or long unused age out first.
+class IntermediateCache {
+
+    struct Entry {
+        std::shared_ptr<intermediate> result;
+        size_t bytes;
+        double cost;
+        double priority;
+        // pinned entries are left out of byPriority, so they are never evicted
+        bool pinned;
+    };
+
+    size_t budget;
+    size_t used;
+    // the part of used held by pinned entries
+    size_t pinnedBytes;
+    double clock;
+
+    std::unordered_map<std::string, Entry> entries;
+    std::set<std::pair<double, std::string>> byPriority;
+
+    mutable std::mutex mutex;
+
+    size_t noHits, noMisses;
+
+    void evict(size_t bytes);
+
+public:
+
+    explicit IntermediateCache(size_t budget);
+
+    // the cached result of key, or nullptr
+    std::shared_ptr<intermediate> get(const std::string &key);
+    // whether key is cached, without counting as a use of the entry
+    bool contains(const std::string &key) const;
+    // cost is the time it took to compute the result (in ms); results that do not fit beside the pinned ones are not cached
+    void put(const std::string &key, std::shared_ptr<intermediate> result, double cost);
+
+    // keep a result (cached now, or added) until unpinAll, evicting others to make room; pinned results
+    // together stay within the budget, and a result that would exceed it is not pinned (returns false)
+    bool pin(const std::string &key, std::shared_ptr<intermediate> result);
+    void unpinAll();
+
+    void setBudget(size_t budget);
+    void clear();
+
+    size_t size() const;
+    size_t bytesUsed() const;
+    size_t hits() const;
+    size_t misses() const;
+};
+
+#endif //QS_INTERMEDIATECACHE_H
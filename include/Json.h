@@ -0,0 +1,13 @@
+//
+// Writing JSON output.
+//
+
+#ifndef QS_JSON_H
+#define QS_JSON_H
+
+#include <string>
+
+// text as a JSON string literal, quotes included
+std::string jsonString(const std::string &text);
+
+#endif //QS_JSON_H
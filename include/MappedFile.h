@@ -0,0 +1,34 @@
+//
+// Read-only view of a whole file, memory-mapped where the platform supports it.
+//
+
+#ifndef QS_MAPPEDFILE_H
+#define QS_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class MappedFile {
+
+    const char *bytes;
+    size_t length;
+    bool mapped;
+
+    // fallback storage on platforms without mmap
+    std::vector<char> buffer;
+
+public:
+
+    explicit MappedFile(const std::string &fileName);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+};
+
+#endif //QS_MAPPEDFILE_H
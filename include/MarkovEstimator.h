@@ -0,0 +1,51 @@
+//
+// Path cardinality estimator over precomputed label-pair synopses.
+//
+
+#ifndef QS_MARKOVESTIMATOR_H
+#define QS_MARKOVESTIMATOR_H
+
+#include "SimpleEstimator.h"
+
+#include <mutex>
+
+// Estimates paths from exact statistics of every single step and every pair of consecutive steps
+// (a step is a label traversed forwards or backwards), composing longer paths as a Markov chain.
+// Estimates are deterministic and cost O(path length); paths with closures fall back to sampling, whose
+// synopses are only built once the first closure is estimated.
+class MarkovEstimator : public SimpleEstimator {
+
+    uint32_t noSteps;
+
+    // {distinct sources, distinct (source, target) pairs, distinct targets} of each step and step pair
+    std::vector<cardStat> stepStats;
+    std::vector<cardStat> pairStats;
+
+    std::mutex samplingMutex;
+    bool samplingPrepared;
+    void prepareSampling();
+
+    static uint32_t stepId(const PathStep &step);
+    static uint32_t inverseStepId(uint32_t step);
+
+    // exact statistics of step a, leaving from sources, followed by step b, which leaves from the vertices in
+    // continues; seen must be all zero, and is again afterwards, reached is overwritten (all three are bitsets
+    // over the vertices)
+    cardStat pairCardinality(uint32_t a, uint32_t b, const std::vector<uint32_t> &sources, const std::vector<uint64_t> &continues,
+                             std::vector<uint64_t> &seen, std::vector<uint64_t> &reached);
+
+public:
+
+    explicit MarkovEstimator(std::shared_ptr<SimpleGraph> &g);
+
+    ~MarkovEstimator() override = default;
+
+    void prepare() override;
+
+    std::vector<cardStat> estimatePrefixes(query_path path,
+                                           uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX) override;
+
+    size_t memoryUsage() const override;
+};
+
+#endif //QS_MARKOVESTIMATOR_H
@@ -0,0 +1,52 @@
+//
+// Query evaluation as sparse boolean matrix products.
+//
+
+#ifndef QS_MATRIXEVALUATOR_H
+#define QS_MATRIXEVALUATOR_H
+
+#include <memory>
+#include <vector>
+
+#include "BoolMatrix.h"
+#include "Evaluator.h"
+#include "RPQTree.h"
+#include "SimpleGraph.h"
+#include "WorkStealingPool.h"
+
+// Evaluates a query as the product of the matrices of its steps, a label's matrix being built from the graph
+// index the first time a query uses it (in that direction). A bound source turns the chain into row-vector products from left to right, a bound target into
+// the same over the transposed (inverse) matrices from right to left, and closures only compute the rows
+// that the product so far can reach.
+class MatrixEvaluator : public Evaluator {
+
+    std::shared_ptr<SimpleGraph> graph;
+
+    // [label] -> source x destination, and its transpose; nullptr until first used
+    std::vector<std::shared_ptr<const BoolMatrix>> forward;
+    std::vector<std::shared_ptr<const BoolMatrix>> inverse;
+
+    WorkStealingPool threadPool;
+
+    static void flatten(RPQTree *q, std::vector<RPQTree *> &steps);
+
+    std::shared_ptr<const BoolMatrix> labelMatrix(RPQTree *leaf, bool transposed);
+    // the closure step, or its transpose, restricted to the given sources (all if nullptr)
+    std::shared_ptr<const BoolMatrix> closureMatrix(RPQTree *q, bool transposed, const std::vector<uint32_t> *sources);
+    // the product of the steps, or the product of their transposes in reverse order if transposed is set,
+    // restricted to the row of source if it is bound
+    std::shared_ptr<const BoolMatrix> evaluatePath(std::vector<RPQTree *> &steps, bool transposed, uint32_t source);
+
+public:
+
+    explicit MatrixEvaluator(std::shared_ptr<SimpleGraph> &g);
+
+    ~MatrixEvaluator() = default;
+
+    void prepare() override;
+
+    cardStat evaluate(RPQTree *query) override;
+    cardStat evaluate(RPQTree *query, uint32_t source, uint32_t target) override;
+};
+
+#endif //QS_MATRIXEVALUATOR_H
@@ -0,0 +1,110 @@
+//
+// Delta-encoded, bit-packed neighbour lists.
+//
+
+#ifndef QS_PACKEDLISTS_H
+#define QS_PACKEDLISTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// values per block; a block of width w takes 4*w words, with value i in 32-bit lane i%4 (BP128 layout),
+// so that four values are unpacked per vector instruction
+const size_t PACKED_BLOCK_SIZE = 128;
+
+// bits of the largest of PACKED_BLOCK_SIZE values
+uint32_t packedWidth(const uint32_t *values);
+// writes 4*width words
+void packBlock(const uint32_t *values, uint32_t width, uint32_t *out);
+// reads 4*width words, writes PACKED_BLOCK_SIZE values
+void unpackBlock(const uint32_t *in, uint32_t width, uint32_t *values);
+
+// value i of a packed block, without unpacking the others
+inline uint32_t packedValue(const uint32_t *in, uint32_t width, uint32_t i) {
+    if (width == 0) return 0;
+    const uint32_t lane = i % 4, bit = (i / 4) * width, word = bit / 32, shift = bit % 32;
+    uint64_t value = in[4 * word + lane] >> shift;
+    if (shift + width > 32) value |= static_cast<uint64_t>(in[4 * (word + 1) + lane]) << (32 - shift);
+    return static_cast<uint32_t>(value & ((uint64_t(1) << width) - 1));
+}
+
+// the CSR lists of one label in one direction, compressed. The lists are concatenated in vertex order into one
+// stream, where the first neighbour of v is stored as the zigzag-encoded difference to v, and every further one
+// as its gap to the previous minus one. The stream is cut into blocks that are bit-packed to the width of their
+// largest value, so a graph whose neighbours lie close together packs tightly. The offsets are kept per group of
+// PACKED_BLOCK_SIZE vertices: the stream position of the group, and a packed block of the offsets of its
+// vertices relative to it, so that the list of any one vertex is found without decoding its neighbours'.
+// The arrays point either into the storage vectors or into a mapped snapshot.
+struct PackedLists {
+    uint32_t noVertices = 0;
+    uint32_t noValues = 0;
+    uint32_t noWords = 0;
+
+    const uint32_t *words = nullptr;
+    // stream position of every group, and noValues behind the last
+    const uint32_t *groupPositions = nullptr;
+    // word offset and width of the relative offsets of every group
+    const uint32_t *offsetBlocks = nullptr;
+    const uint8_t *offsetWidths = nullptr;
+    // word offset and width of every block of the stream
+    const uint32_t *valueBlocks = nullptr;
+    const uint8_t *valueWidths = nullptr;
+
+    std::vector<uint32_t> wordStorage;
+    std::vector<uint32_t> groupPositionStorage;
+    std::vector<uint32_t> offsetBlockStorage;
+    std::vector<uint8_t> offsetWidthStorage;
+    std::vector<uint32_t> valueBlockStorage;
+    std::vector<uint8_t> valueWidthStorage;
+
+    PackedLists() = default;
+    PackedLists(const PackedLists &) = delete;
+    PackedLists &operator=(const PackedLists &) = delete;
+
+    static std::shared_ptr<PackedLists> pack(const uint32_t *offsets, const uint32_t *targets, uint32_t noVertices);
+
+    uint32_t noGroups() const { return static_cast<uint32_t>((uint64_t(noVertices) + PACKED_BLOCK_SIZE - 1) / PACKED_BLOCK_SIZE); }
+    uint32_t noValueBlocks() const { return static_cast<uint32_t>((uint64_t(noValues) + PACKED_BLOCK_SIZE - 1) / PACKED_BLOCK_SIZE); }
+    // whether every block lies within the words and the groups cover the stream, for lists read from a file
+    bool isConsistent() const;
+
+    // stream position of the list of v, for v up to noVertices
+    uint32_t offset(uint32_t v) const {
+        const size_t g = v / PACKED_BLOCK_SIZE;
+        const uint32_t i = v % PACKED_BLOCK_SIZE;
+        return groupPositions[g] + (i == 0 ? 0 : packedValue(words + offsetBlocks[g], offsetWidths[g], i));
+    }
+    uint32_t degree(uint32_t v) const { return offset(v + 1) - offset(v); }
+    // the stored value at a stream position
+    uint32_t value(uint32_t position) const {
+        const size_t b = position / PACKED_BLOCK_SIZE;
+        return packedValue(words + valueBlocks[b], valueWidths[b], position % PACKED_BLOCK_SIZE);
+    }
+    // bytes of the arrays, whether on the heap or mapped
+    size_t memoryUsage() const;
+};
+
+// decodes the lists of a PackedLists. Long runs of the stream, and lists that continue where the previous one
+// ended, are unpacked a block at a time, and the last block is kept, so that reading lists in vertex order
+// unpacks every block once; short lists elsewhere are read value by value.
+class PackedReader {
+    const PackedLists *lists;
+
+    uint32_t values[PACKED_BLOCK_SIZE];
+    size_t block;
+    // the vertex after the last list read, and its stream position
+    uint32_t next;
+    uint32_t end;
+    std::vector<uint32_t> list;
+
+public:
+    explicit PackedReader(const PackedLists &lists);
+
+    uint32_t degree(uint32_t v) const { return lists->degree(v); }
+    // the sorted neighbours of v, valid until the next call
+    const std::vector<uint32_t> &neighbours(uint32_t v);
+};
+
+#endif //QS_PACKEDLISTS_H
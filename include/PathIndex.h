@@ -0,0 +1,98 @@
+//
+// Workload-driven index of materialized short label paths.
+//
+
+#ifndef QS_PATHINDEX_H
+#define QS_PATHINDEX_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "RPQTree.h"
+#include "SimpleGraph.h"
+
+// returned for a path that is not materialized
+const uint32_t NO_PATH_LABEL = UINT32_MAX;
+
+// the result of one label path as the CSR indexes of a label, in both directions
+struct MaterializedPath {
+    AdjacencyIndex forward;
+    AdjacencyIndex reverse;
+    // the sizes of the intermediates evaluating the path produces, saved on every use
+    uint64_t work = 0;
+    size_t bytes = 0;
+};
+
+// one generation of the index. Its graph has the labels of the base graph, sharing their indexes, followed by
+// one label per path the advisor ever materialized: a path keeps its label across generations, so results keyed
+// by it stay valid, and the labels of paths dropped since have no index.
+struct PathIndex {
+    std::shared_ptr<SimpleGraph> base;
+    std::shared_ptr<SimpleGraph> graph;
+    std::vector<std::shared_ptr<const MaterializedPath>> indexes;
+
+    uint32_t noBaseLabels = 0;
+    // the path of every label from noBaseLabels on, e.g. "0+1-"
+    std::vector<std::string> paths;
+    // the label of every path materialized in this generation
+    std::unordered_map<std::string, uint32_t> labels;
+    size_t bytes = 0;
+    // milliseconds the advisor took to build this generation
+    double buildTime = 0;
+
+    uint32_t find(const std::string &path) const {
+        auto search = labels.find(path);
+        return search == labels.end() ? NO_PATH_LABEL : search->second;
+    }
+};
+
+// a path of the workload with the number of times it occurred
+struct PathCandidate {
+    std::string key;
+    query_path steps;
+    uint64_t frequency;
+};
+
+// Counts the label paths of MIN_PATH_LENGTH to MAX_PATH_LENGTH steps that executed queries consist of, and
+// materializes the most valuable ones within a byte budget: those saving the most intermediate work per byte,
+// weighted by how often they occur. record and candidates belong to the evaluating thread, build may run in
+// the background, one build at a time.
+class PathIndexAdvisor {
+
+    std::unordered_map<std::string, PathCandidate> counts;
+
+    // permanent labels (from the base graph's label count on) of every path materialized so far
+    std::vector<std::string> paths;
+    std::unordered_map<std::string, uint32_t> labelOffsets;
+    // the paths of the latest generation, reused by the next one
+    std::unordered_map<std::string, std::shared_ptr<const MaterializedPath>> materialized;
+
+    // the intermediate work and index bytes of a path, from the edge counts of its labels
+    static void estimate(const SimpleGraph &base, const query_path &steps, uint64_t &work, size_t &bytes);
+    // the path's indexes, or nullptr once they would take more than limit bytes
+    static std::shared_ptr<const MaterializedPath> materialize(std::shared_ptr<SimpleGraph> &base, const query_path &steps,
+                                                               size_t limit);
+
+public:
+
+    static const size_t MIN_PATH_LENGTH = 2;
+    static const size_t MAX_PATH_LENGTH = 3;
+
+    // counts the label-only windows of a path, times times
+    void record(const query_path &path, uint64_t times = 1);
+    bool empty() const { return counts.empty(); }
+
+    // the most frequent paths, of at least two occurrences
+    std::vector<PathCandidate> candidates() const;
+
+    // the next generation over the given candidates
+    std::shared_ptr<PathIndex> build(std::shared_ptr<SimpleGraph> base, const std::vector<PathCandidate> &candidates,
+                                     size_t budget);
+
+    // "0+1-" for the label steps of a path
+    static std::string key(const query_path &steps);
+};
+
+#endif //QS_PATHINDEX_H
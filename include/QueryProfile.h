@@ -0,0 +1,80 @@
+//
+// Per-operator execution profiles of query evaluation.
+//
+
+#ifndef QS_QUERYPROFILE_H
+#define QS_QUERYPROFILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// one executed operator of a plan
+struct OperatorProfile {
+    uint32_t query = 0;
+    // project, join, closure, count (a top join that is only counted) or cached (a cache hit)
+    std::string name;
+    // the subpath the operator produces, as its cache key
+    std::string path;
+    // thread that ran it, numbered in order of first appearance
+    uint32_t thread = 0;
+    // microseconds since the profiler was created
+    double start = 0, end = 0;
+    // paths of the left and right inputs; a label read from the graph counts its edges
+    uint64_t leftInput = 0, rightInput = 0;
+    uint64_t output = 0;
+    // heap footprint of the output, 0 for cache hits and counts
+    size_t bytes = 0;
+    // the estimator's noPaths for the subpath, negative without one
+    double estimate = -1;
+};
+
+// a profiled query: what was evaluated, and when
+struct QueryRecord {
+    std::string description;
+    double start = 0, end = 0;
+};
+
+// Collects the operators of every query evaluated while it is attached to an evaluator (see
+// SimpleEvaluator::setProfiler). Operators run on the workers of the pool, so recording is thread-safe.
+class QueryProfiler {
+    mutable std::mutex mutex;
+    const std::chrono::steady_clock::time_point epoch;
+
+    std::vector<QueryRecord> queries;
+    std::vector<OperatorProfile> operators;
+    std::unordered_map<std::thread::id, uint32_t> threads;
+    // estimated noPaths by cache key, as planned by the optimizer
+    std::unordered_map<std::string, double> estimates;
+
+public:
+    QueryProfiler();
+
+    // microseconds since the profiler was created
+    double now() const;
+
+    // starts a query and returns its id for the operators it runs
+    uint32_t beginQuery(const std::string &description);
+    void endQuery(uint32_t query);
+    // records an operator run by the calling thread
+    void record(OperatorProfile op);
+
+    void setEstimate(const std::string &key, double noPaths);
+    double estimate(const std::string &key) const;
+
+    std::vector<QueryRecord> getQueries() const;
+    std::vector<OperatorProfile> getOperators() const;
+
+    // trace-event JSON, as read by chrome://tracing and Perfetto: one track per thread, plus one for the queries
+    void writeChromeTrace(std::ostream &out) const;
+    // a table of the operators of every query, in the order they started
+    void printSummary(std::ostream &out) const;
+    void clear();
+};
+
+#endif //QS_QUERYPROFILE_H
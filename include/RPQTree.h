@@ -7,6 +7,8 @@
 
 #include <string>
 #include <algorithm>
+#include <cstdint>
+#include <vector>
 
 class RPQTree {
 
@@ -22,6 +24,8 @@ public:
     void print();
 
     bool isConcat();
+    // Kleene closure over the left subtree: '+' (one or more) or '*' (zero or more)
+    bool isClosure();
 
     bool isLeaf();
     bool isUnary();
@@ -29,5 +33,20 @@ public:
 
 };
 
+// one step of a flattened concatenation: a label in either direction,
+// or a closure over a subquery (traversed inversely when forward is false)
+struct PathStep {
+    uint32_t label;
+    bool forward;
+    RPQTree *closure; // not owned, nullptr for a label step
+
+    PathStep(uint32_t label, bool forward) : label(label), forward(forward), closure(nullptr) {}
+    explicit PathStep(RPQTree *closure) : label(0), forward(true), closure(closure) {}
+
+    bool isClosure() const { return closure != nullptr; }
+};
+
+typedef std::vector<PathStep> query_path;
+
 
 #endif //QS_RPQTREE_H
@@ -0,0 +1,44 @@
+//
+// Semi-join reduction of path queries.
+//
+
+#ifndef QS_SEMIJOINREDUCER_H
+#define QS_SEMIJOINREDUCER_H
+
+#include <memory>
+#include <vector>
+
+#include "RPQTree.h"
+#include "SimpleGraph.h"
+
+// a path query restricted to the vertices that take part in at least one complete match
+struct ReducedQuery {
+    // the original labels (sharing the original indexes), followed by one label per label step of the path
+    std::shared_ptr<SimpleGraph> graph;
+    // the label of every step in graph, traversed forwards; closure steps keep their original subquery
+    std::vector<uint32_t> stepLabels;
+    // some position of the path has no vertex left, so the query has no result
+    bool empty = false;
+};
+
+// Yannakakis-style reduction over vertex bitsets, one per position between two steps: a forward pass marks
+// the vertices each position can be reached at from the source, a backward pass keeps those from which the
+// rest of the path still reaches the target. Every label step then becomes its own label, a filtered view of
+// the original index that only yields edges between surviving vertices. Closures over a label are followed by BFS; closures over a subquery are
+// not traversed, and leave their positions unrestricted.
+class SemiJoinReducer {
+
+    typedef std::vector<uint64_t> VertexSet;
+
+    static bool contains(const VertexSet &set, uint32_t v) { return (set[v / 64] >> (v % 64)) & 1; }
+    static void insert(VertexSet &set, uint32_t v) { set[v / 64] |= uint64_t(1) << (v % 64); }
+
+    // the vertices reached from a set over one step, forwards or backwards; false if the step is not traversed
+    static bool image(const SimpleGraph &g, const PathStep &step, bool backwards, const VertexSet &from, VertexSet &to);
+
+public:
+
+    static ReducedQuery reduce(const SimpleGraph &g, const query_path &path, uint32_t source, uint32_t target);
+};
+
+#endif //QS_SEMIJOINREDUCER_H
@@ -5,6 +5,7 @@
 #ifndef QS_SIMPLEESTIMATOR_H
 #define QS_SIMPLEESTIMATOR_H
 
+#include "DistinctSketch.h"
 #include "Estimator.h"
 #include "SimpleGraph.h"
 
@@ -22,34 +23,73 @@ public:
 
 class SimpleEstimator : public Estimator {
 
+protected:
+
     std::shared_ptr<SimpleGraph> graph;
 
-    std::unordered_map<uint32_t, std::unordered_map<uint32_t, std::vector<uint32_t>>> vertexIndexByLabel;
-    std::unordered_map<uint32_t, std::unordered_map<uint32_t, std::vector<uint32_t>>> vertexIndexByLabelReverse;
-    std::unordered_map<uint32_t, std::vector<uint32_t>> outVertexByLabel;
-    std::unordered_map<uint32_t, std::vector<uint32_t>> inVertexByLabel;
+    void unpackQueryTree(query_path *path, RPQTree *q);
+    static void invertPath(query_path &path);
+
+private:
+
+    // the vertices with an out- and in-edge of every label; the neighbours themselves are read from the graph
+    std::vector<std::vector<uint32_t>> outVertexByLabel;
+    std::vector<std::vector<uint32_t>> inVertexByLabel;
+
+    std::vector<uint32_t> allVertices;
+
+    // distinct sources and destinations of every label, and of the whole vertex set
+    std::vector<DistinctSketch> outSketches;
+    std::vector<DistinctSketch> inSketches;
+    DistinctSketch allSketch;
 
-    void unpackQueryTree(std::vector<std::pair<uint32_t, bool>> *path, RPQTree *q);
+    query_path innerPath(const PathStep &step);
+    std::vector<uint32_t> *startVertices(const PathStep &step);
+
+    // sketches of the vertices a step can start from, and can end in when entered from the previous domain
+    DistinctSketch sourceDomain(const PathStep &step);
+    DistinctSketch targetDomain(const PathStep &step, const DistinctSketch &previous);
+    // expected number of distinct values among noPaths uniform draws from a domain (Cardenas' formula)
+    static double expectedDistinct(double noPaths, double domain);
+
+    // exact (deduplicated) image of a vertex set under a path or closure, cut off at limit vertices
+    void pathImage(const query_path &path, std::vector<uint32_t> &vertices, uint32_t limit);
+    void closureImage(const PathStep &step, std::vector<uint32_t> &vertices, uint32_t limit);
 
     void generateSampleIds(uint32_t maxId, std::vector<uint32_t> *sampleIds, uint32_t n);
 
     double generateSampling(std::vector<uint32_t> *from, std::vector<uint32_t> *to, uint32_t sampleSize);
 
-    double indexBasedJoinSampling(std::unordered_map<uint32_t, std::vector<uint32_t>> *index,
+    double indexBasedJoinSampling(const AdjacencyIndex &index,
                                   std::vector<uint32_t> *from, std::vector<uint32_t> *to,
                                   uint32_t sampleSize);
 
+    double closureSampling(const PathStep &step, std::vector<uint32_t> *from, std::vector<uint32_t> *to,
+                           uint32_t sampleSize);
+
 public:
 
     explicit SimpleEstimator(std::shared_ptr<SimpleGraph> &g);
 
-    ~SimpleEstimator() = default;
+    virtual ~SimpleEstimator() = default;
 
     void prepare() override;
 
     cardStat estimate(RPQTree *q) override;
+    cardStat estimate(RPQTree *q, uint32_t source, uint32_t target);
+
+    // estimate a path whose endpoints may be bound to a vertex (or ANY_VERTEX)
+    cardStat estimate_aux(query_path path,
+                          uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX);
+
+    // estimates of every prefix path[0..j] from one sampled walk; a bound target only applies to the full path
+    virtual std::vector<cardStat> estimatePrefixes(query_path path,
+                                                   uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX);
+    // estimates of every suffix path[i..n-1] ending in the bound target, from one walk over the inverse path
+    std::vector<cardStat> estimateSuffixes(query_path path, uint32_t target);
 
-    cardStat estimate_aux(std::vector<std::pair<uint32_t, bool>> path);
+    // heap footprint of the synopses built by prepare
+    virtual size_t memoryUsage() const;
 };
 
 #endif //QS_SIMPLEESTIMATOR_H
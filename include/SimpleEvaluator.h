@@ -10,9 +10,10 @@
 #include <cmath>
 #include <thread>
 #include <vector>
-#include <queue>
 #include <mutex>
 #include <future>
+#include <exception>
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -21,99 +22,68 @@
 #include "RPQTree.h"
 #include "Evaluator.h"
 #include "Graph.h"
+#include "WorkStealingPool.h"
+#include "Intermediate.h"
+#include "IntermediateCache.h"
+#include "PathIndex.h"
+#include "QueryProfile.h"
 
-// --- begin thread pool class
-
-class ThreadedJobPool {
-private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> jobs;
-
-    std::mutex mutex;
-    std::condition_variable cv;
-
-    bool stop;
-
-    void workerLoop() {
-        while (true) {
-            std::function<void()> job;
-            {
-                std::unique_lock<std::mutex> lock(mutex);
-                cv.wait(lock, [&]{ return stop || !jobs.empty(); });
-                if (stop && jobs.empty()) {
-                    return;
-                }
-                job = std::move(jobs.front());
-                jobs.pop();
-            }
-            job();
-        }
-    }
 
-public:
-    explicit ThreadedJobPool(size_t nWorkers);
-
-    template<class F, class... Args>
-    std::shared_future<typename std::result_of<F(Args...)>::type> enqueue(F&& f, Args&&... args) {
-        using return_type = typename std::result_of<F(Args...)>::type;
-
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-                std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-
-        std::future<return_type> res = task->get_future();
-        {
-            std::unique_lock<std::mutex> lock(mutex);
-            jobs.emplace([task](){
-                (*task)();
-            });
-        }
-        cv.notify_one();
-        return res.share();
-    }
-
-    ~ThreadedJobPool();
-};
 
-inline ThreadedJobPool::ThreadedJobPool(size_t nWorkers)
-        : stop(false)
-{
-    for (size_t n = 0; n < nWorkers; ++n) {
-        std::cout << "Creating worker...\n";
-        workers.emplace_back(&ThreadedJobPool::workerLoop, this);
-    }
-}
-
-inline ThreadedJobPool::~ThreadedJobPool() {
-    {
-        std::unique_lock<std::mutex> lock(mutex);
-        stop = true;
-    }
-    cv.notify_all();
-    for (std::thread &worker : workers) {
-        std::cout << "Joining worker...\n";
-        worker.join();
-    }
-}
-
-// --- end thread pool class
-
-
-typedef std::unordered_map<uint32_t, std::vector<uint32_t>> intermediate;
-typedef std::vector<std::pair<uint32_t, bool>> query_path;
+// called with the result of an asynchronously evaluated subplan
+typedef std::function<void(std::shared_ptr<intermediate>)> continuation;
+// called instead, at most once, with the exception of an operator of the subplan
+typedef std::function<void(std::exception_ptr)> failure;
+
+// a query of a batch, with its (possibly bound) endpoints
+struct batchQuery {
+    RPQTree *query;
+    uint32_t source;
+    uint32_t target;
+};
 
 class SimpleEvaluator : public Evaluator {
 
     std::shared_ptr<SimpleGraph> graph;
     std::shared_ptr<SimpleEstimator> est;
 
-    std::unordered_map<std::string, std::shared_ptr<intermediate>> evalCache;
+    // subpath results by pathToString(path, source, target), shared by the synchronous and asynchronous executors
+    IntermediateCache evalCache;
     std::unordered_map<std::string, cardStat> statCache;
 
-    void unpackQueryTree(query_path *path, RPQTree *q);
     std::string pathToString(query_path *path);
+    std::string pathToString(query_path *path, uint32_t source, uint32_t target);
+
+    WorkStealingPool threadPool;
+
+    // prune every query to the vertices of complete matches before joining (see SemiJoinReducer)
+    bool semiJoinReduction;
+
+    // points the label leaves of a plan, in path order, at the per-step labels of a reduced graph
+    static void relabelPlan(RPQTree *plan, const std::vector<uint32_t> &stepLabels, size_t &step);
 
-    ThreadedJobPool threadPool;
+    // short label paths of the workload materialized as labels of the evaluated graph, which is then the
+    // index's graph. Plans read them like single labels, and cache keys spell them out as their paths.
+    PathIndexAdvisor pathAdvisor;
+    std::shared_ptr<PathIndex> pathIndex;
+    size_t pathIndexBudget;
+    size_t recordedSinceBuild;
+    std::future<std::shared_ptr<PathIndex>> pendingPathIndex;
+
+    // installs a finished background build, and starts the next one once enough queries were recorded
+    void updatePathIndex();
+    // builds the next generation of the index right away
+    void rebuildPathIndex();
+    void installPathIndex(std::shared_ptr<PathIndex> index);
+
+    // records every operator while attached; the plans being scheduled belong to profiledQuery
+    std::shared_ptr<QueryProfiler> profiler;
+    uint32_t profiledQuery;
+    // the original steps of the labels of a reduced graph, while a reduced plan is scheduled
+    std::unordered_map<uint32_t, PathStep> reducedSteps;
+
+    // the cache key of the subpath q produces, which its operator is profiled under
+    std::string profileKey(RPQTree *q, uint32_t source, uint32_t target, bool reduced);
 
 public:
     explicit SimpleEvaluator(std::shared_ptr<SimpleGraph> &g);
@@ -123,19 +93,80 @@ public:
     void prepare() override;
 
     cardStat evaluate(RPQTree *query) override;
+    // evaluate with bound endpoints (or ANY_VERTEX), the constants are pushed into the plan's outer leaves
+    cardStat evaluate(RPQTree *query, uint32_t source, uint32_t target) override;
 
-    void attachEstimator(std::shared_ptr<SimpleEstimator> &e);
-
-    std::shared_ptr<intermediate> evaluate_aux(RPQTree *q);
-    std::shared_future<std::shared_ptr<intermediate>> evaluate_async(RPQTree *q);
-
-    static std::shared_ptr<intermediate> project(uint32_t label, bool inverse, std::shared_ptr<SimpleGraph> &g);
+    // evaluates a whole workload at once: subpaths shared between queries are computed once and reused
+    std::vector<cardStat> evaluateBatch(std::vector<batchQuery> &queries);
 
-    static std::shared_ptr<intermediate> join(std::shared_ptr<intermediate> &left, std::shared_ptr<intermediate> &right);
+    void attachEstimator(std::shared_ptr<SimpleEstimator> &e);
+    void setCacheBudget(size_t bytes);
+    void setSemiJoinReduction(bool enabled);
+    // bytes of materialized label paths, 0 (the default) disables the path index
+    void setPathIndexBudget(size_t bytes);
+    const PathIndex *getPathIndex() const { return pathIndex.get(); }
+    const IntermediateCache &getCache() const { return evalCache; }
+    // profiles every query evaluated from now on, nullptr stops profiling
+    void setProfiler(std::shared_ptr<QueryProfiler> p);
+
+    std::shared_ptr<intermediate> evaluate_aux(RPQTree *q, uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX);
+    // evaluates a plan whose top join is never materialized, only counted
+    cardStat evaluateStats(RPQTree *q, uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX);
+    // the asynchronous executor runs on the evaluator's graph, or on the reduced graph of a single query if one is
+    // given, whose results are specific to that query and therefore bypass the intermediate cache
+    void evaluateStats_async(RPQTree *q, uint32_t source, uint32_t target, std::function<void(cardStat)> done,
+                             failure fail, std::shared_ptr<SimpleGraph> reduced = nullptr);
+    // schedules the operators of q on the thread pool, each once its inputs are ready, and passes the result to done,
+    // or the first exception of an operator (or of a continuation) to fail
+    void evaluate_async(RPQTree *q, uint32_t source, uint32_t target, continuation done, failure fail,
+                        std::shared_ptr<SimpleGraph> reduced = nullptr);
+    // evaluates left (with the source) and right (with the target) concurrently and continues with both results
+    void evaluateBoth_async(RPQTree *left, uint32_t source, RPQTree *right, uint32_t target,
+                            std::function<void(std::shared_ptr<intermediate>, std::shared_ptr<intermediate>)> done,
+                            failure fail, std::shared_ptr<SimpleGraph> reduced = nullptr);
+
+    // the operators below split unbound inputs into morsels that run in parallel on the pool, if one is given
+    static std::shared_ptr<intermediate> project(uint32_t label, bool inverse, std::shared_ptr<SimpleGraph> &g,
+                                                 uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX,
+                                                 WorkStealingPool *pool = nullptr);
+
+    // joins produce sorted, duplicate-free destination lists per source
+    static std::shared_ptr<intermediate> join(std::shared_ptr<intermediate> &left, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                                              WorkStealingPool *pool = nullptr);
+    // join with a single label, reading its neighbours straight from the graph's CSR index
+    static std::shared_ptr<intermediate> join(std::shared_ptr<intermediate> &left, uint32_t rightLabel, bool rightInverse, std::shared_ptr<SimpleGraph> &g,
+                                              uint32_t target = ANY_VERTEX, WorkStealingPool *pool = nullptr);
+    static std::shared_ptr<intermediate> join(uint32_t leftLabel, bool leftInverse, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                                              uint32_t source = ANY_VERTEX, WorkStealingPool *pool = nullptr);
+
+    // the same joins, counting their output into a cardStat instead of materializing it
+    static cardStat joinStats(std::shared_ptr<intermediate> &left, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                              WorkStealingPool *pool = nullptr);
+    static cardStat joinStats(std::shared_ptr<intermediate> &left, uint32_t rightLabel, bool rightInverse, std::shared_ptr<SimpleGraph> &g,
+                              uint32_t target = ANY_VERTEX, WorkStealingPool *pool = nullptr);
+    static cardStat joinStats(uint32_t leftLabel, bool leftInverse, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                              uint32_t source = ANY_VERTEX, WorkStealingPool *pool = nullptr);
+
+    // closure of a subquery's relation (inner), or of a label when the subquery is a leaf and inner is empty
+    static std::shared_ptr<intermediate> closure(RPQTree *q, std::shared_ptr<intermediate> &inner, std::shared_ptr<SimpleGraph> &g,
+                                                 uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX,
+                                                 WorkStealingPool *pool = nullptr);
+    // bit-parallel multi-source BFS over step, 64 sources per machine word, in morsels of batches on the pool;
+    // a single bound source is searched on its own
+    static std::shared_ptr<intermediate> transitiveClosure(const AdjacencyIndex &step, bool reflexive, uint32_t noVertices,
+                                                           uint32_t source = ANY_VERTEX, WorkStealingPool *pool = nullptr);
+
+    static void parseLeaf(RPQTree *leaf, uint32_t &label, bool &inverse);
+    static bool joinsRightLeaf(RPQTree *q, uint32_t source, uint32_t target);
 
     cardStat computeStats(std::shared_ptr<intermediate> &result);
 
-    RPQTree *optimizeQuery(query_path *path);
+    // the steps of a query: its labels, with every closure as one step
+    void unpackQueryTree(query_path *path, RPQTree *q);
+    // usePathIndex and useCache let the plan read subpaths from the path index and the intermediate cache
+    RPQTree *optimizeQuery(query_path *path, uint32_t source = ANY_VERTEX, uint32_t target = ANY_VERTEX,
+                           bool usePathIndex = true, bool useCache = true);
+    RPQTree *planFromSplits(query_path *path, std::vector<std::vector<size_t>> &splits, size_t i, size_t j);
 };
 
 
@@ -8,25 +8,133 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include <memory>
 #include <iostream>
 #include <regex>
 #include <fstream>
 #include "Graph.h"
+#include "MappedFile.h"
+#include "PackedLists.h"
+
+// compressed sparse row adjacency of one label in one direction:
+// the neighbours of v are targets[offsets[v]] .. targets[offsets[v+1]-1], sorted and without duplicates.
+// offsets and targets point either into the storage vectors or into a mapped snapshot. A packed index
+// (see SimpleGraph::compressIndexes) has neither, and its lists are only read through a NeighbourReader,
+// as are those of a filtered view.
+struct AdjacencyIndex {
+    std::vector<uint32_t> offsetStorage;
+    std::vector<uint32_t> targetStorage;
+
+    const uint32_t *offsets = nullptr;
+    const uint32_t *targets = nullptr;
+    uint32_t noTargets = 0;
+
+    std::shared_ptr<const PackedLists> packed;
+
+    // a view restricted to the edges from a vertex of sourceFilter to a vertex of targetFilter (bitsets over
+    // the vertices), as made per query by SemiJoinReducer; noTargets counts the remaining edges
+    std::shared_ptr<const std::vector<uint64_t>> sourceFilter;
+    std::shared_ptr<const std::vector<uint64_t>> targetFilter;
+
+    AdjacencyIndex() = default;
+    AdjacencyIndex(const AdjacencyIndex &) = delete;
+    AdjacencyIndex(AdjacencyIndex &&) = default;
+    AdjacencyIndex &operator=(AdjacencyIndex &&) = default;
+
+    bool isPacked() const { return packed != nullptr; }
+    bool isFiltered() const { return sourceFilter != nullptr; }
+    // of the underlying lists, regardless of filters
+    uint32_t degree(uint32_t v) const { return packed ? packed->degree(v) : offsets[v + 1] - offsets[v]; }
+    // plain indexes only
+    const uint32_t *begin(uint32_t v) const { return targets + offsets[v]; }
+    const uint32_t *end(uint32_t v) const { return targets + offsets[v + 1]; }
+
+    // shares the lists of another index, which must outlive this one
+    void view(const AdjacencyIndex &other) {
+        offsets = other.offsets;
+        targets = other.targets;
+        noTargets = other.noTargets;
+        packed = other.packed;
+        sourceFilter = other.sourceFilter;
+        targetFilter = other.targetFilter;
+    }
+};
+
+// a neighbour list: sorted vertex ids
+struct NeighbourRange {
+    const uint32_t *first;
+    const uint32_t *last;
+
+    const uint32_t *begin() const { return first; }
+    const uint32_t *end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+};
+
+// reads the lists of a plain or packed index; plain lists are returned in place, packed and filtered ones
+// are decoded into the reader and stay valid until its next call. A reader is used by one thread at a time.
+class NeighbourReader {
+    const AdjacencyIndex *index;
+    std::unique_ptr<PackedReader> packed;
+    std::vector<uint32_t> filtered;
+
+    NeighbourRange list(uint32_t v) {
+        if (packed == nullptr) return {index->begin(v), index->end(v)};
+        const auto &list = packed->neighbours(v);
+        return {list.data(), list.data() + list.size()};
+    }
+    NeighbourRange filter(uint32_t v);
+
+public:
+    explicit NeighbourReader(const AdjacencyIndex &index)
+        : index(&index), packed(index.isPacked() ? new PackedReader(*index.packed) : nullptr) {}
+
+    NeighbourRange operator()(uint32_t v) {
+        return index->isFiltered() ? filter(v) : list(v);
+    }
+    uint32_t degree(uint32_t v) {
+        if (index->isFiltered()) return static_cast<uint32_t>((*this)(v).size());
+        return packed == nullptr ? index->degree(v) : packed->degree(v);
+    }
+};
+
+// orders the vertices of a graph can be relabelled in after loading, so that vertices visited together lie close
+// together in the indexes and in per-vertex arrays: hubs first (degree), breadth-first from the hubs (bfs), or
+// reverse Cuthill-McKee (rcm), which numbers every neighbourhood contiguously
+enum class VertexOrder { input, degree, bfs, rcm };
 
 class SimpleGraph : public Graph {
 public:
     // [label] -> [(source1, destination1), (source2, destination2), ...]
     std::vector<std::vector<std::pair<uint32_t, uint32_t>>> edgeLists;
 
+    // [label] -> CSR index, source -> destinations
+    std::vector<AdjacencyIndex> forwardIndex;
+    // [label] -> CSR index, destination -> sources
+    std::vector<AdjacencyIndex> reverseIndex;
+
 protected:
     uint32_t V;
     uint32_t L;
+    uint64_t E;
+
+    // backing memory of the indexes when the graph was read from a snapshot
+    std::unique_ptr<MappedFile> snapshot;
 
-    bool getValuesFromLine(std::string &line, char sep, uint32_t (&values)[3]);
+    // pack the indexes of every label as soon as they are built (see compressOnBuild)
+    bool packIndexes;
+
+    // input id -> internal id and back after reorderVertices, empty while the ids are the input's
+    std::vector<uint32_t> internalIds;
+    std::vector<uint32_t> externalIds;
+
+    std::vector<uint32_t> vertexOrder(VertexOrder order) const;
+
+    static bool getValuesFromLine(const char *pos, const char *end, char sep, uint32_t (&values)[3]);
 
 public:
 
-    SimpleGraph() : V(0), L(0) {};
+    SimpleGraph() : V(0), L(0), E(0), packIndexes(false) {};
     ~SimpleGraph() = default;
     explicit SimpleGraph(uint32_t n);
 
@@ -41,6 +149,39 @@ public:
     void setNoVertices(uint32_t n);
     void setNoLabels(uint32_t noLabels);
 
+    // (re)build the CSR indexes from the edge lists, called after reading the graph
+    void buildIndexes();
+    // CSR index over any list of (source, destination) pairs, keyed on the destination when reverse is set
+    static void buildAdjacency(const std::vector<std::pair<uint32_t, uint32_t>> &edges, bool reverse,
+                               uint32_t noVertices, AdjacencyIndex &index);
+    const AdjacencyIndex &getIndex(uint32_t label, bool inverse) const;
+
+    // relabels the vertices in the given order, rebuilding the edge lists and indexes
+    void reorderVertices(VertexOrder order);
+    // replaces every index by its packed form and drops the edge lists
+    void compressIndexes();
+    // packs the indexes of every label as soon as they are built (on reading, reordering, or from a plain
+    // snapshot) and drops the label's edge list, so that the graph is never held uncompressed as a whole
+    void compressOnBuild();
+    bool isCompressed() const;
+    // heap (or mapped) footprint of the indexes and edge lists
+    size_t memoryUsage() const;
+    // the id a vertex of the input has in the graph, and back; ANY_VERTEX and ids outside the graph are kept
+    uint32_t internalId(uint32_t v) const { return v < internalIds.size() ? internalIds[v] : v; }
+    uint32_t externalId(uint32_t v) const { return v < externalIds.size() ? externalIds[v] : v; }
+    // a graph over the same vertices whose first labels share the indexes of base, which must outlive it,
+    // followed by noExtraLabels labels whose indexes are left to the caller
+    static std::shared_ptr<SimpleGraph> extend(const SimpleGraph &base, uint32_t noExtraLabels);
+
+    // binary snapshot: header, label directory, then the CSR offset/target sections of every label, or the
+    // sections of its packed lists if the graph is compressed. a graph read from a snapshot has no edge lists
+    // and its indexes point into the read-only mapping. Reading checks that every section lies within the file,
+    // and verify checks the lists in one more pass over them: without it, the snapshot is trusted input, and
+    // corrupt offsets or vertex ids lead to reads and writes out of bounds during evaluation.
+    void writeSnapshot(const std::string &fileName) const;
+    void readFromSnapshot(const std::string &fileName, bool verify = true);
+    static bool isSnapshot(const std::string &fileName);
+
 };
 
 #endif //QS_SIMPLEGRAPH_H
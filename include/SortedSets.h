@@ -0,0 +1,29 @@
+//
+// Vectorized kernels over sorted lists of vertex ids.
+//
+
+#ifndef QS_SORTEDSETS_H
+#define QS_SORTEDSETS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Every kernel has a scalar, an SSE4.1 and an AVX2 version; the widest one the CPU supports is picked on
+// first use. Vector stores may write up to SORTED_SET_PADDING values past the end of an output.
+const size_t SORTED_SET_PADDING = 8;
+
+// union of two sorted, duplicate-free lists into out, which must hold na + nb + SORTED_SET_PADDING values;
+// returns the size of the union
+size_t sortedUnion(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+
+// intersection of two sorted, duplicate-free lists into out, which must hold min(na, nb) + SORTED_SET_PADDING
+// values; returns the size of the intersection
+size_t sortedIntersection(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+
+// removes the duplicates of a sorted list in place and returns its new size
+size_t sortedDedup(uint32_t *data, size_t n);
+
+// "avx2", "sse4.1" or "scalar"
+const char *sortedSetKernels();
+
+#endif //QS_SORTEDSETS_H
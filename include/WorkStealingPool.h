@@ -0,0 +1,70 @@
+//
+// Work-stealing thread pool for fire-and-forget tasks.
+//
+
+#ifndef QS_WORKSTEALINGPOOL_H
+#define QS_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Every worker owns a deque: it pushes and pops its own tasks at the back (depth first) while idle
+// workers steal from the front of the others. Tasks never wait on each other; dependent work is
+// submitted as a continuation once its inputs are ready, so no worker is ever blocked.
+class WorkStealingPool {
+
+    struct Task {
+        std::function<void()> run;
+        // receives what run throws
+        std::function<void(std::exception_ptr)> fail;
+    };
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    // sleeping workers wait for queued tasks here
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    std::atomic<size_t> noQueued;
+    bool stop;
+
+    // queue of the next task submitted from outside the pool
+    std::atomic<size_t> nextQueue;
+
+    bool pop(size_t self, Task &task);
+    bool steal(size_t self, Task &task);
+    void workerLoop(size_t self);
+
+public:
+
+    explicit WorkStealingPool(size_t nWorkers = std::max(1u, std::thread::hardware_concurrency()));
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // queue a task; tasks submitted by a worker stay on that worker unless they are stolen. An exception
+    // thrown by the task is passed to fail on the worker; a task without fail must not throw
+    void submit(std::function<void()> task, std::function<void(std::exception_ptr)> fail = nullptr);
+
+    // run body(0) .. body(noMorsels - 1) on the pool; the calling thread takes morsels too, and only waits
+    // for morsels that other threads are already processing, so it is safe to call from inside a task. The
+    // first exception thrown by body is rethrown to the caller once the morsels already started are done
+    void parallelFor(size_t noMorsels, const std::function<void(size_t)> &body);
+
+    size_t size() const { return workers.size(); }
+};
+
+#endif //QS_WORKSTEALINGPOOL_H
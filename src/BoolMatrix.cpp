@@ -0,0 +1,324 @@
+//
+// Sparse boolean matrices over the vertices of a graph.
+//
+
+#include "BoolMatrix.h"
+
+#include <algorithm>
+#include <functional>
+
+// rows are split into morsels of at least MIN_MORSEL_ROWS, a few morsels per worker
+static const size_t MIN_MORSEL_ROWS = 1024;
+static const size_t MORSELS_PER_WORKER = 4;
+
+static size_t noMorsels(WorkStealingPool *pool, size_t noRows) {
+    if (pool == nullptr) return 1;
+    return std::max<size_t>(1, std::min(pool->size() * MORSELS_PER_WORKER, noRows / MIN_MORSEL_ROWS));
+}
+
+static void forEachMorsel(WorkStealingPool *pool, size_t n, const std::function<void(size_t)> &body) {
+    if (pool == nullptr || n == 1) {
+        for (size_t morsel = 0; morsel < n; ++morsel) body(morsel);
+        return;
+    }
+    pool->parallelFor(n, body);
+}
+
+BoolMatrix BoolMatrix::fromIndex(const AdjacencyIndex &index, uint32_t noVertices, uint32_t source) {
+    BoolMatrix out(noVertices);
+    NeighbourReader neighbours(index);
+    uint32_t first = source == ANY_VERTEX ? 0 : source;
+    uint32_t last = source == ANY_VERTEX ? noVertices : source + 1;
+    for (uint32_t v = first; v < last; ++v) {
+        Row row;
+        auto range = neighbours(v);
+        row.count = static_cast<uint32_t>(range.size());
+        if (isDense(row.count, noVertices)) {
+            row.bits.assign(noVertices / 64 + 1, 0);
+            for (auto w : range) {
+                row.bits[w / 64] |= uint64_t(1) << (w % 64);
+            }
+        } else {
+            row.columns.assign(range.begin(), range.end());
+        }
+        out.append(v, std::move(row));
+    }
+    return out;
+}
+
+const BoolMatrix::Row *BoolMatrix::find(uint32_t id) const {
+    if (!slots.empty()) {
+        return slots[id] == UINT32_MAX ? nullptr : &rows[slots[id]];
+    }
+    auto position = std::lower_bound(rowIds.begin(), rowIds.end(), id);
+    if (position == rowIds.end() || *position != id) return nullptr;
+    return &rows[position - rowIds.begin()];
+}
+
+void BoolMatrix::indexRows() {
+    slots.assign(n, UINT32_MAX);
+    for (uint32_t i = 0; i < rowIds.size(); ++i) {
+        slots[rowIds[i]] = i;
+    }
+}
+
+void BoolMatrix::append(uint32_t id, Row &&row) {
+    if (row.count == 0) return;
+    rowIds.push_back(id);
+    rows.push_back(std::move(row));
+}
+
+void BoolMatrix::takeRow(std::vector<uint64_t> &accumulator, std::vector<uint32_t> &touched, bool scan,
+                         uint32_t n, Row &row) {
+    if (scan) {
+        row.count = 0;
+        for (auto word : accumulator) row.count += static_cast<uint32_t>(__builtin_popcountll(word));
+        if (isDense(row.count, n)) {
+            row.bits = accumulator;
+            std::fill(accumulator.begin(), accumulator.end(), 0);
+        } else {
+            row.columns.reserve(row.count);
+            for (size_t w = 0; w < accumulator.size(); ++w) {
+                for (uint64_t word = accumulator[w]; word != 0; word &= word - 1) {
+                    row.columns.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+                }
+                accumulator[w] = 0;
+            }
+        }
+        touched.clear();
+        return;
+    }
+
+    row.count = static_cast<uint32_t>(touched.size());
+    if (isDense(row.count, n)) {
+        row.bits.assign(accumulator.size(), 0);
+        for (auto column : touched) {
+            row.bits[column / 64] |= uint64_t(1) << (column % 64);
+            accumulator[column / 64] = 0;
+        }
+    } else {
+        for (auto column : touched) {
+            accumulator[column / 64] = 0;
+        }
+        std::sort(touched.begin(), touched.end());
+        row.columns.assign(touched.begin(), touched.end());
+    }
+    touched.clear();
+}
+
+BoolMatrix BoolMatrix::concatenate(std::vector<BoolMatrix> &parts, uint32_t n) {
+    if (parts.size() == 1) return std::move(parts[0]);
+    BoolMatrix out(n);
+    size_t size = 0;
+    for (const auto &part : parts) size += part.rowIds.size();
+    out.rowIds.reserve(size);
+    out.rows.reserve(size);
+    for (auto &part : parts) {
+        out.rowIds.insert(out.rowIds.end(), part.rowIds.begin(), part.rowIds.end());
+        std::move(part.rows.begin(), part.rows.end(), std::back_inserter(out.rows));
+        part = BoolMatrix(n);
+    }
+    return out;
+}
+
+std::vector<uint32_t> BoolMatrix::columnIds() const {
+    std::vector<uint64_t> seen(n / 64 + 1, 0);
+    for (const auto &row : rows) {
+        if (row.isDense()) {
+            for (size_t w = 0; w < seen.size(); ++w) seen[w] |= row.bits[w];
+        } else {
+            for (auto column : row.columns) seen[column / 64] |= uint64_t(1) << (column % 64);
+        }
+    }
+    std::vector<uint32_t> columns;
+    for (size_t w = 0; w < seen.size(); ++w) {
+        for (uint64_t word = seen[w]; word != 0; word &= word - 1) {
+            columns.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+        }
+    }
+    return columns;
+}
+
+cardStat BoolMatrix::stats() const {
+    cardStat stats {static_cast<uint32_t>(rows.size()), 0, 0};
+    std::vector<uint64_t> seen(n / 64 + 1, 0);
+    for (const auto &row : rows) {
+        stats.noPaths += row.count;
+        if (row.isDense()) {
+            for (size_t w = 0; w < seen.size(); ++w) seen[w] |= row.bits[w];
+        } else {
+            for (auto column : row.columns) seen[column / 64] |= uint64_t(1) << (column % 64);
+        }
+    }
+    for (auto word : seen) {
+        stats.noIn += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    return stats;
+}
+
+void BoolMatrix::restrictToColumn(uint32_t column) {
+    size_t kept = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const Row &row = rows[i];
+        bool contains = row.isDense()
+                        ? (row.bits[column / 64] >> (column % 64)) & 1
+                        : std::binary_search(row.columns.begin(), row.columns.end(), column);
+        if (!contains) continue;
+        rowIds[kept] = rowIds[i];
+        rows[kept] = Row();
+        rows[kept].columns = {column};
+        rows[kept].count = 1;
+        ++kept;
+    }
+    rowIds.resize(kept);
+    rows.resize(kept);
+    slots.clear();
+}
+
+BoolMatrix BoolMatrix::multiply(const BoolMatrix &a, const BoolMatrix &b, WorkStealingPool *pool) {
+    const uint32_t n = a.n;
+    const size_t m = noMorsels(pool, a.rowIds.size());
+    std::vector<BoolMatrix> parts(m, BoolMatrix(n));
+
+    forEachMorsel(pool, m, [&](size_t morsel) {
+        std::vector<uint64_t> accumulator(n / 64 + 1, 0);
+        std::vector<uint32_t> touched;
+        const size_t first = a.rowIds.size() * morsel / m;
+        const size_t last = a.rowIds.size() * (morsel + 1) / m;
+
+        for (size_t i = first; i < last; ++i) {
+            // once a dense row has been ORed in, the accumulator is scanned instead of tracking columns
+            bool scan = false;
+            forEachColumn(a.rows[i], [&](uint32_t middle) {
+                const Row *right = b.find(middle);
+                if (right == nullptr) return;
+                if (right->isDense()) {
+                    for (size_t w = 0; w < accumulator.size(); ++w) accumulator[w] |= right->bits[w];
+                    scan = true;
+                    return;
+                }
+                for (auto column : right->columns) {
+                    auto &word = accumulator[column / 64];
+                    uint64_t mask = uint64_t(1) << (column % 64);
+                    if (!(word & mask)) {
+                        word |= mask;
+                        if (!scan) touched.push_back(column);
+                    }
+                }
+            });
+
+            Row row;
+            takeRow(accumulator, touched, scan, n, row);
+            parts[morsel].append(a.rowIds[i], std::move(row));
+        }
+    });
+
+    return concatenate(parts, n);
+}
+
+BoolMatrix BoolMatrix::closure(bool reflexive, const std::vector<uint32_t> *sources, WorkStealingPool *pool) const {
+    std::vector<uint32_t> allSources;
+    if (sources == nullptr) {
+        if (reflexive) {
+            allSources.resize(n);
+            for (uint32_t v = 0; v < n; ++v) allSources[v] = v;
+        } else {
+            allSources = rowIds;
+        }
+        sources = &allSources;
+    }
+
+    const size_t m = noMorsels(pool, sources->size());
+    std::vector<BoolMatrix> parts(m, BoolMatrix(n));
+
+    forEachMorsel(pool, m, [&](size_t morsel) {
+        // bit i of a vertex's word belongs to the i-th source of the current batch of 64
+        std::vector<uint64_t> visited(n, 0), frontier(n, 0), next(n, 0);
+        std::vector<uint32_t> active, nextActive, reached;
+        std::vector<Row> batchRows(64);
+        const size_t first = sources->size() * morsel / m;
+        const size_t last = sources->size() * (morsel + 1) / m;
+
+        for (size_t batch = first; batch < last; batch += 64) {
+            const size_t batchSize = std::min<size_t>(64, last - batch);
+
+            // the sources themselves are only reached again through a cycle (or by reflexivity below)
+            active.clear();
+            reached.clear();
+            for (size_t i = 0; i < batchSize; ++i) {
+                const uint32_t v = (*sources)[batch + i];
+                if (frontier[v] == 0) active.push_back(v);
+                frontier[v] |= uint64_t(1) << i;
+            }
+
+            // one sweep per BFS level, moving all sources' frontiers at once
+            while (!active.empty()) {
+                nextActive.clear();
+                for (auto v : active) {
+                    const uint64_t bits = frontier[v];
+                    frontier[v] = 0;
+                    const Row *step = find(v);
+                    if (step == nullptr) continue;
+                    forEachColumn(*step, [&](uint32_t w) {
+                        const uint64_t fresh = bits & ~visited[w];
+                        if (fresh == 0) return;
+                        if (visited[w] == 0) reached.push_back(w);
+                        visited[w] |= fresh;
+                        if (next[w] == 0) nextActive.push_back(w);
+                        next[w] |= fresh;
+                    });
+                }
+                std::swap(frontier, next);
+                std::swap(active, nextActive);
+            }
+
+            // a row is written straight into its bitset if it turns out dense, else as a list; visiting the
+            // reached vertices in order keeps the lists sorted
+            uint32_t counts[64] = {0};
+            for (auto w : reached) {
+                for (uint64_t bits = visited[w]; bits != 0; bits &= bits - 1) ++counts[__builtin_ctzll(bits)];
+            }
+            bool sparse = false;
+            for (size_t i = 0; i < batchSize; ++i) {
+                const uint32_t source = (*sources)[batch + i];
+                const bool self = (visited[source] >> i) & 1;
+                Row &row = batchRows[i];
+                row = Row();
+                row.count = counts[i] + (reflexive && !self ? 1 : 0);
+                if (isDense(row.count, n)) {
+                    row.bits.assign(n / 64 + 1, 0);
+                } else {
+                    row.columns.reserve(row.count);
+                    sparse = true;
+                }
+            }
+            if (sparse) std::sort(reached.begin(), reached.end());
+            for (auto w : reached) {
+                for (uint64_t bits = visited[w]; bits != 0; bits &= bits - 1) {
+                    Row &row = batchRows[__builtin_ctzll(bits)];
+                    if (row.isDense()) {
+                        row.bits[w / 64] |= uint64_t(1) << (w % 64);
+                    } else {
+                        row.columns.push_back(w);
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < batchSize; ++i) {
+                const uint32_t source = (*sources)[batch + i];
+                Row &row = batchRows[i];
+                if (reflexive && !((visited[source] >> i) & 1)) {
+                    if (row.isDense()) {
+                        row.bits[source / 64] |= uint64_t(1) << (source % 64);
+                    } else {
+                        row.columns.insert(std::lower_bound(row.columns.begin(), row.columns.end(), source), source);
+                    }
+                }
+                parts[morsel].append(source, std::move(row));
+            }
+            for (auto w : reached) visited[w] = 0;
+        }
+    });
+
+    return concatenate(parts, n);
+}
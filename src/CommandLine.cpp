@@ -0,0 +1,37 @@
+//
+// Parsing shared by the command line tools.
+//
+
+#include "CommandLine.h"
+#include "MarkovEstimator.h"
+
+#include <stdexcept>
+
+uint32_t parseEndpoint(const std::string &endpoint, const SimpleGraph &g) {
+    if (endpoint == "*") return ANY_VERTEX;
+
+    // digits only, surrounding blanks aside; ANY_VERTEX itself is no vertex id
+    const size_t first = endpoint.find_first_not_of(" \t\r");
+    const size_t last = endpoint.find_last_not_of(" \t\r");
+    uint64_t id = 0;
+    bool valid = first != std::string::npos;
+    for (size_t i = first; valid && i <= last; ++i) {
+        valid = endpoint[i] >= '0' && endpoint[i] <= '9';
+        id = id * 10 + (endpoint[i] - '0');
+        valid = valid && id < ANY_VERTEX;
+    }
+    if (!valid) {
+        throw std::runtime_error("Invalid query endpoint: '" + endpoint + "'");
+    }
+    return g.internalId(static_cast<uint32_t>(id));
+}
+
+std::shared_ptr<SimpleEstimator> makeEstimator(const std::string &name, std::shared_ptr<SimpleGraph> &g) {
+    if (name == "markov") return std::make_shared<MarkovEstimator>(g);
+    if (name == "sampling") return std::make_shared<SimpleEstimator>(g);
+    throw std::runtime_error("Unknown estimator: " + name);
+}
+
+bool isEstimator(const std::string &name) {
+    return name == "markov" || name == "sampling";
+}
@@ -0,0 +1,64 @@
+//
+// HyperLogLog sketch of the number of distinct vertices in a set.
+//
+
+#include "DistinctSketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+DistinctSketch::DistinctSketch(uint32_t precision) : precision(precision), registers(1u << precision, 0) {
+    if (precision < 4 || precision > 16) {
+        throw std::runtime_error("Sketch precision must be between 4 and 16");
+    }
+}
+
+// splitmix64 finalizer, vertex ids are far from uniformly distributed
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+void DistinctSketch::add(uint32_t vertex) {
+    const uint64_t hash = mix(vertex);
+    const uint64_t bucket = hash >> (64 - precision);
+    const uint64_t rest = hash << precision;
+    // position of the first set bit in the remaining bits
+    const auto rank = static_cast<uint8_t>(rest == 0 ? 64 - precision + 1 : __builtin_clzll(rest) + 1);
+    registers[bucket] = std::max(registers[bucket], rank);
+}
+
+void DistinctSketch::merge(const DistinctSketch &other) {
+    if (other.precision != precision) {
+        throw std::runtime_error("Cannot merge sketches of different precision");
+    }
+    for (size_t i = 0; i < registers.size(); ++i) {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+}
+
+void DistinctSketch::clear() {
+    std::fill(registers.begin(), registers.end(), 0);
+}
+
+double DistinctSketch::estimate() const {
+    const double m = registers.size();
+    double sum = 0;
+    uint32_t noZeros = 0;
+    for (auto r : registers) {
+        sum += 1.0 / static_cast<double>(1ull << r);
+        if (r == 0) ++noZeros;
+    }
+
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double raw = alpha * m * m / sum;
+
+    // linear counting is more accurate while many registers are still empty
+    if (raw <= 2.5 * m && noZeros > 0) {
+        return m * std::log(m / noZeros);
+    }
+    return raw;
+}
@@ -0,0 +1,204 @@
+//
+// Deterministic synthetic graphs and path queries for benchmarking.
+//
+
+#include "GraphGenerator.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+GraphGenerator::GraphGenerator(const GraphSpec &spec) : spec(spec) {
+    if (spec.noVertices == 0 || spec.noLabels == 0) {
+        throw std::runtime_error(std::string("A generated graph needs at least one vertex and one label"));
+    }
+    if (spec.noEdges > UINT32_MAX) {
+        throw std::runtime_error("Too many edges to generate: " + std::to_string(spec.noEdges));
+    }
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        uint64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+void GraphGenerator::forEachEdge(const std::function<void(uint32_t, uint32_t, uint32_t)> &edge) const {
+    SplitMix64 rng(spec.seed);
+    const uint32_t V = spec.noVertices;
+    const uint32_t L = spec.noLabels;
+
+    // the skewed draws favour low ids; a fixed permutation spreads the heavy vertices over the id range
+    uint64_t multiplier = 2654435761ULL % V;
+    if (multiplier == 0) multiplier = 1;
+    while (gcd(multiplier, V) != 1) ++multiplier;
+    const uint64_t shift = rng.next() % V;
+    auto scramble = [&](uint64_t v) { return static_cast<uint32_t>((v * multiplier + shift) % V); };
+
+    // P(id < x) = sqrt(x / V): the first 1% of the ids take a tenth of the draws, and the degree of the
+    // vertex of rank r falls off as 1 / sqrt(r)
+    auto skewed = [&]() {
+        const double u = rng.unit();
+        return scramble(std::min<uint64_t>(V - 1, static_cast<uint64_t>(V * u * u)));
+    };
+
+    const uint32_t noHubs = std::max<uint32_t>(1, V / 10000);
+
+    for (uint64_t e = 0; e < spec.noEdges; ++e) {
+        uint32_t source = 0, label = 0, target = 0;
+        switch (spec.shape) {
+            case GraphShape::uniform:
+                source = rng.below(V);
+                target = rng.below(V);
+                label = rng.below(L);
+                break;
+            case GraphShape::powerLaw: {
+                source = skewed();
+                target = skewed();
+                const double u = rng.unit();
+                label = std::min<uint32_t>(L - 1, static_cast<uint32_t>(L * u * u));
+                break;
+            }
+            case GraphShape::hubs:
+                source = rng.below(V);
+                target = rng.below(V);
+                if (rng.next() & 1) {
+                    if (rng.next() & 1) source = scramble(rng.below(noHubs));
+                    else target = scramble(rng.below(noHubs));
+                }
+                label = rng.below(L);
+                break;
+        }
+        edge(source, label, target);
+    }
+}
+
+// appends the decimal digits of value
+static char *writeNumber(char *out, uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) *out++ = digits[--n];
+    return out;
+}
+
+void GraphGenerator::writeText(const std::string &fileName) const {
+    std::ofstream file { fileName, std::ios::binary | std::ios::trunc };
+    if (!file) {
+        throw std::runtime_error("Could not open graph file for writing: " + fileName);
+    }
+    file << spec.noVertices << ',' << spec.noEdges << ',' << spec.noLabels << '\n';
+
+    // every line takes at most 3 * 10 digits and " .\n"
+    const size_t BUFFER_SIZE = size_t(1) << 20;
+    std::vector<char> buffer(BUFFER_SIZE + 64);
+    char *out = buffer.data();
+    forEachEdge([&](uint32_t source, uint32_t label, uint32_t target) {
+        out = writeNumber(out, source);
+        *out++ = ' ';
+        out = writeNumber(out, label);
+        *out++ = ' ';
+        out = writeNumber(out, target);
+        std::memcpy(out, " .\n", 3);
+        out += 3;
+        if (out - buffer.data() >= static_cast<ptrdiff_t>(BUFFER_SIZE)) {
+            file.write(buffer.data(), out - buffer.data());
+            out = buffer.data();
+        }
+    });
+    file.write(buffer.data(), out - buffer.data());
+
+    if (!file) {
+        throw std::runtime_error("Failed writing graph file: " + fileName);
+    }
+}
+
+void GraphGenerator::fill(SimpleGraph &g) const {
+    g.setNoVertices(spec.noVertices);
+    g.setNoLabels(spec.noLabels);
+    forEachEdge([&g](uint32_t source, uint32_t label, uint32_t target) {
+        g.addEdge(source, target, label);
+    });
+    g.buildIndexes();
+}
+
+GraphShape GraphGenerator::parseShape(const std::string &name) {
+    if (name == "uniform") return GraphShape::uniform;
+    if (name == "power-law") return GraphShape::powerLaw;
+    if (name == "hubs") return GraphShape::hubs;
+    throw std::runtime_error("Unknown graph shape: " + name);
+}
+
+std::string GraphGenerator::shapeName(GraphShape shape) {
+    switch (shape) {
+        case GraphShape::uniform: return "uniform";
+        case GraphShape::powerLaw: return "power-law";
+        case GraphShape::hubs: return "hubs";
+    }
+    return "";
+}
+
+std::vector<GeneratedQuery> generateQueries(const SimpleGraph &g, const QuerySpec &spec) {
+    SplitMix64 rng(spec.seed);
+    const uint32_t V = g.getNoVertices();
+    const uint32_t L = g.getNoLabels();
+
+    // step 2*label + 1 walks the label backwards
+    std::vector<NeighbourReader> readers;
+    for (uint32_t step = 0; step < 2 * L; ++step) readers.emplace_back(g.getIndex(step / 2, step % 2 == 1));
+
+    std::vector<GeneratedQuery> queries;
+    std::vector<uint32_t> options;
+    // a graph with few edges may not allow every walk; give up rather than loop forever
+    for (uint64_t attempt = 0; queries.size() < spec.noQueries && attempt < 100 * uint64_t(spec.noQueries) + 1000; ++attempt) {
+        const uint32_t length = spec.minLength + rng.below(spec.maxLength - spec.minLength + 1);
+        const uint32_t start = rng.below(V);
+
+        uint32_t v = start;
+        std::vector<uint32_t> steps;
+        for (uint32_t k = 0; k < length; ++k) {
+            // the labels leaving v in the walk's preferred direction, or else in any direction
+            options.clear();
+            const bool backwards = rng.unit() < spec.inverseRate;
+            for (uint32_t label = 0; label < L; ++label) {
+                if (readers[2 * label + backwards].degree(v) > 0) options.push_back(2 * label + backwards);
+            }
+            if (options.empty()) {
+                for (uint32_t label = 0; label < L; ++label) {
+                    if (readers[2 * label + !backwards].degree(v) > 0) options.push_back(2 * label + !backwards);
+                }
+            }
+            if (options.empty()) break;
+
+            const uint32_t step = options[rng.below(static_cast<uint32_t>(options.size()))];
+            auto neighbours = readers[step](v);
+            v = neighbours.begin()[rng.below(static_cast<uint32_t>(neighbours.size()))];
+            steps.push_back(step);
+        }
+        if (steps.size() < spec.minLength || steps.empty()) continue;
+
+        GeneratedQuery query {"*", "", "*"};
+        if (rng.unit() < spec.boundRate) {
+            if (rng.next() & 1) query.source = std::to_string(g.externalId(start));
+            else query.target = std::to_string(g.externalId(v));
+        }
+        // the closure of a label over all vertices is about the square of its largest component, so only
+        // queries with a bound endpoint get one
+        const bool closure = (query.source != "*" || query.target != "*") && rng.unit() < spec.closureRate;
+        for (size_t k = 0; k < steps.size(); ++k) {
+            std::string leaf = std::to_string(steps[k] / 2) + (steps[k] % 2 == 1 ? "-" : "+");
+            // a closure around the last step still matches the walk
+            if (closure && k + 1 == steps.size()) leaf = "(" + leaf + ")+";
+            if (k > 0) query.path += '/';
+            query.path += leaf;
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}
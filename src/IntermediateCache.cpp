@@ -0,0 +1,128 @@
+//
+// Byte-bounded, thread-safe cache of intermediate results.
+//
+
+#include "IntermediateCache.h"
+
+IntermediateCache::IntermediateCache(size_t budget) :
+    budget(budget), used(0), pinnedBytes(0), clock(0), noHits(0), noMisses(0) {}
+
+std::shared_ptr<intermediate> IntermediateCache::get(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto search = entries.find(key);
+    if (search == entries.end()) {
+        ++noMisses;
+        return nullptr;
+    }
+    ++noHits;
+
+    auto &entry = search->second;
+    if (!entry.pinned) {
+        byPriority.erase({entry.priority, key});
+        entry.priority = clock + entry.cost / entry.bytes;
+        byPriority.insert({entry.priority, key});
+    }
+    return entry.result;
+}
+
+bool IntermediateCache::contains(const std::string &key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.count(key) > 0;
+}
+
+void IntermediateCache::put(const std::string &key, std::shared_ptr<intermediate> result, double cost) {
+    const size_t bytes = memoryUsage(*result);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // pinned entries cannot be evicted, so only the rest of the budget is available
+    if (pinnedBytes + bytes > budget || entries.count(key) > 0) return;
+
+    evict(bytes);
+    const double priority = clock + cost / bytes;
+    entries[key] = {std::move(result), bytes, cost, priority, false};
+    byPriority.insert({priority, key});
+    used += bytes;
+}
+
+bool IntermediateCache::pin(const std::string &key, std::shared_ptr<intermediate> result) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto search = entries.find(key);
+    if (search != entries.end()) {
+        auto &entry = search->second;
+        if (entry.pinned) return true;
+        if (pinnedBytes + entry.bytes > budget) return false;
+        byPriority.erase({entry.priority, key});
+        entry.pinned = true;
+        pinnedBytes += entry.bytes;
+        return true;
+    }
+
+    const size_t bytes = memoryUsage(*result);
+    if (pinnedBytes + bytes > budget) return false;
+    evict(bytes);
+    entries[key] = {std::move(result), bytes, 0, 0, true};
+    used += bytes;
+    pinnedBytes += bytes;
+    return true;
+}
+
+void IntermediateCache::unpinAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &keyEntryPair : entries) {
+        auto &entry = keyEntryPair.second;
+        if (!entry.pinned) continue;
+        entry.pinned = false;
+        entry.priority = clock + entry.cost / entry.bytes;
+        byPriority.insert({entry.priority, keyEntryPair.first});
+    }
+    pinnedBytes = 0;
+    evict(0);
+}
+
+void IntermediateCache::evict(size_t bytes) {
+    while (used + bytes > budget && !byPriority.empty()) {
+        auto victim = byPriority.begin();
+        clock = victim->first;
+        auto search = entries.find(victim->second);
+        used -= search->second.bytes;
+        entries.erase(search);
+        byPriority.erase(victim);
+    }
+}
+
+void IntermediateCache::setBudget(size_t newBudget) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = newBudget;
+    evict(0);
+}
+
+void IntermediateCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    byPriority.clear();
+    used = 0;
+    pinnedBytes = 0;
+    clock = 0;
+}
+
+size_t IntermediateCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t IntermediateCache::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+size_t IntermediateCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return noHits;
+}
+
+size_t IntermediateCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return noMisses;
+}
@@ -0,0 +1,23 @@
+//
+// Writing JSON output.
+//
+
+#include "Json.h"
+
+std::string jsonString(const std::string &text) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += "\\u00";
+            out += HEX[(c >> 4) & 0xf];
+            out += HEX[c & 0xf];
+        } else {
+            out += c;
+        }
+    }
+    return out + '"';
+}
@@ -0,0 +1,62 @@
+//
+// Read-only view of a whole file, memory-mapped where the platform supports it.
+//
+
+#include "MappedFile.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &fileName) : bytes(nullptr), length(0), mapped(false) {
+#ifndef _WIN32
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + fileName);
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not stat file: " + fileName);
+    }
+    length = static_cast<size_t>(info.st_size);
+
+    if (length > 0) {
+        void *address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Could not map file: " + fileName);
+        }
+        bytes = static_cast<const char *>(address);
+        mapped = true;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+#else
+    std::ifstream file { fileName, std::ios::binary | std::ios::ate };
+    if (!file) {
+        throw std::runtime_error("Could not open file: " + fileName);
+    }
+    length = static_cast<size_t>(file.tellg());
+    buffer.resize(length);
+    file.seekg(0);
+    file.read(buffer.data(), length);
+    bytes = buffer.data();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char *>(bytes), length);
+    }
+#endif
+}
@@ -0,0 +1,197 @@
+//
+// Path cardinality estimator over precomputed label-pair synopses.
+//
+
+#include "MarkovEstimator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+MarkovEstimator::MarkovEstimator(std::shared_ptr<SimpleGraph> &g) : SimpleEstimator(g), noSteps(0), samplingPrepared(false) {}
+
+uint32_t MarkovEstimator::stepId(const PathStep &step) {
+    return step.label * 2 + (step.forward ? 0 : 1);
+}
+
+uint32_t MarkovEstimator::inverseStepId(uint32_t step) {
+    return step ^ 1u;
+}
+
+cardStat MarkovEstimator::pairCardinality(uint32_t a, uint32_t b, const std::vector<uint32_t> &sources,
+                                          const std::vector<uint64_t> &continues,
+                                          std::vector<uint64_t> &seen, std::vector<uint64_t> &reached) {
+    NeighbourReader first(graph->getIndex(a / 2, a % 2 == 1));
+    NeighbourReader second(graph->getIndex(b / 2, b % 2 == 1));
+
+    // one bit per vertex keeps the sets in the L2 cache of a million-vertex graph, so most mids are passed over
+    // without a look at the index of b; the targets of a source are unmarked one by one, which costs no more
+    // than marking them
+    std::fill(reached.begin(), reached.end(), 0);
+    std::vector<uint32_t> targets;
+    // counted wide: the distinct pairs of a heavy label pair may exceed 32 bits on a large graph
+    uint64_t noOut = 0, noPaths = 0, noIn = 0;
+    for (auto source : sources) {
+        for (auto mid : first(source)) {
+            if (!((continues[mid / 64] >> (mid % 64)) & 1)) continue;
+            for (auto target : second(mid)) {
+                const uint64_t bit = uint64_t(1) << (target % 64);
+                if (seen[target / 64] & bit) continue;
+                seen[target / 64] |= bit;
+                targets.push_back(target);
+                if (!(reached[target / 64] & bit)) {
+                    reached[target / 64] |= bit;
+                    ++noIn;
+                }
+            }
+        }
+        if (!targets.empty()) ++noOut;
+        noPaths += targets.size();
+        for (auto target : targets) seen[target / 64] = 0;
+        targets.clear();
+    }
+    auto clamp = [](uint64_t value) { return static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX)); };
+    return {clamp(noOut), clamp(noPaths), clamp(noIn)};
+}
+
+void MarkovEstimator::prepareSampling() {
+    std::lock_guard<std::mutex> lock(samplingMutex);
+    if (samplingPrepared) return;
+    SimpleEstimator::prepare();
+    samplingPrepared = true;
+}
+
+void MarkovEstimator::prepare() {
+    // closures are not covered by the synopses and are still estimated by sampling, prepared on demand
+    {
+        std::lock_guard<std::mutex> lock(samplingMutex);
+        samplingPrepared = false;
+    }
+
+    const uint32_t V = graph->getNoVertices();
+    noSteps = graph->getNoLabels() * 2;
+
+    // the vertices every step leaves from, as a list and as a bitset, so that a pair only visits the sources of
+    // its first step, and only follows the second step from where it has edges
+    std::vector<std::vector<uint32_t>> stepSources(noSteps);
+    std::vector<std::vector<uint64_t>> stepBits(noSteps, std::vector<uint64_t>(V / 64 + 1, 0));
+    stepStats.assign(noSteps, {0, 0, 0});
+    for (uint32_t step = 0; step < noSteps; ++step) {
+        const auto &index = graph->getIndex(step / 2, step % 2 == 1);
+        NeighbourReader forward(index), inverse(graph->getIndex(step / 2, step % 2 == 0));
+        for (uint32_t v = 0; v < V; ++v) {
+            if (forward.degree(v) > 0) {
+                stepSources[step].push_back(v);
+                stepBits[step][v / 64] |= uint64_t(1) << (v % 64);
+            }
+            if (inverse.degree(v) > 0) ++stepStats[step].noIn;
+        }
+        stepStats[step].noOut = static_cast<uint32_t>(stepSources[step].size());
+        stepStats[step].noPaths = index.noTargets;
+    }
+
+    // a/b is the inverse of b^-1/a^-1, so only one pair of each mirrored couple is computed
+    pairStats.assign(static_cast<size_t>(noSteps) * noSteps, {0, 0, 0});
+    std::atomic<uint32_t> nextPair { 0 };
+    auto computePairs = [&]() {
+        std::vector<uint64_t> seen(V / 64 + 1, 0), reached(V / 64 + 1, 0);
+        for (uint32_t pair = nextPair++; pair < noSteps * noSteps; pair = nextPair++) {
+            const uint32_t a = pair / noSteps, b = pair % noSteps;
+            const uint32_t mirror = inverseStepId(b) * noSteps + inverseStepId(a);
+            if (mirror < pair) continue;
+            if (stepStats[a].noPaths == 0 || stepStats[b].noPaths == 0) continue;
+
+            const auto stat = pairCardinality(a, b, stepSources[a], stepBits[b], seen, reached);
+            pairStats[pair] = stat;
+            pairStats[mirror] = {stat.noIn, stat.noPaths, stat.noOut};
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const unsigned int noThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 1; i < std::min(noThreads, noSteps * noSteps); ++i) {
+        workers.emplace_back(computePairs);
+    }
+    computePairs();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+size_t MarkovEstimator::memoryUsage() const {
+    return SimpleEstimator::memoryUsage() - sizeof(SimpleEstimator) + sizeof(*this) +
+           (stepStats.capacity() + pairStats.capacity()) * sizeof(cardStat);
+}
+
+std::vector<cardStat> MarkovEstimator::estimatePrefixes(query_path path, uint32_t source, uint32_t target) {
+    if (path.empty()) { return {}; }
+    if ((source != ANY_VERTEX && source >= graph->getNoVertices()) ||
+        (target != ANY_VERTEX && target >= graph->getNoVertices())) {
+        return std::vector<cardStat>(path.size(), {0, 0, 0});
+    }
+    for (const auto &step : path) {
+        if (step.isClosure()) {
+            prepareSampling();
+            return SimpleEstimator::estimatePrefixes(path, source, target);
+        }
+    }
+
+    auto clamp = [](double value) {
+        return static_cast<uint32_t>(std::min<double>(std::round(value), UINT32_MAX));
+    };
+
+    // unbound prefixes: exact up to length 2, then each further step scales the number of paths by the
+    // average fan-out of the previous step into the next one, P(s_k | s_k-1) = |s_k-1/s_k| / |s_k-1|
+    std::vector<double> noPaths(path.size());
+    std::vector<cardStat> prefixes(path.size());
+    uint32_t previous = stepId(path[0]);
+    prefixes[0] = stepStats[previous];
+    noPaths[0] = stepStats[previous].noPaths;
+    for (size_t k = 1; k < path.size(); ++k) {
+        const uint32_t current = stepId(path[k]);
+        const cardStat &pair = pairStats[previous * noSteps + current];
+        if (k == 1) {
+            noPaths[k] = pair.noPaths;
+        } else if (stepStats[previous].noPaths > 0) {
+            noPaths[k] = noPaths[k - 1] * pair.noPaths / stepStats[previous].noPaths;
+        } else {
+            noPaths[k] = 0;
+        }
+        const uint32_t paths = clamp(noPaths[k]);
+        prefixes[k] = {std::min(prefixes[k - 1].noOut, paths), paths, std::min(pair.noIn, paths)};
+        previous = current;
+    }
+
+    const PathStep &last = path.back();
+    const bool targetHasIn = target == ANY_VERTEX || graph->getIndex(last.label, last.forward).degree(target) > 0;
+
+    if (source == ANY_VERTEX) {
+        if (target != ANY_VERTEX) {
+            // the sources reaching one of the noIn end vertices, if the target is one of them at all
+            const auto &full = prefixes.back();
+            const uint32_t paths = targetHasIn && full.noIn > 0 ? clamp(noPaths.back() / full.noIn) : 0;
+            prefixes.back() = {paths, paths, paths > 0 ? 1u : 0u};
+        }
+        return prefixes;
+    }
+
+    // bound source: the first step is read from the index, later steps scale by the same fan-out
+    double reached = graph->getIndex(path[0].label, !path[0].forward).degree(source);
+    std::vector<cardStat> bound(path.size());
+    for (size_t k = 0; k < path.size(); ++k) {
+        if (k > 0 && noPaths[k - 1] > 0) {
+            reached = std::min<double>(reached * noPaths[k] / noPaths[k - 1], prefixes[k].noIn);
+        } else if (k > 0) {
+            reached = 0;
+        }
+
+        uint32_t paths = clamp(reached);
+        if (target != ANY_VERTEX && k + 1 == path.size()) {
+            // chance that the target is among the reached end vertices
+            paths = targetHasIn && prefixes[k].noIn > 0 && reached / prefixes[k].noIn >= 0.5 ? 1 : 0;
+        }
+        bound[k] = {paths > 0 ? 1u : 0u, paths, paths};
+    }
+    return bound;
+}
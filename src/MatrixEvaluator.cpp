@@ -0,0 +1,127 @@
+//
+// Query evaluation as sparse boolean matrix products.
+//
+
+#include "MatrixEvaluator.h"
+#include "SimpleEstimator.h"
+#include "SimpleEvaluator.h"
+
+MatrixEvaluator::MatrixEvaluator(std::shared_ptr<SimpleGraph> &g) : graph(g), threadPool() {}
+
+void MatrixEvaluator::prepare() {
+    // the matrices are copies of the graph's indexes, so only those of the labels queried are built
+    forward.assign(graph->getNoLabels(), nullptr);
+    inverse.assign(graph->getNoLabels(), nullptr);
+}
+
+void MatrixEvaluator::flatten(RPQTree *q, std::vector<RPQTree *> &steps) {
+    if (q->isConcat()) {
+        flatten(q->left, steps);
+        flatten(q->right, steps);
+    } else {
+        steps.push_back(q);
+    }
+}
+
+std::shared_ptr<const BoolMatrix> MatrixEvaluator::labelMatrix(RPQTree *leaf, bool transposed) {
+    uint32_t label;
+    bool inverseLabel;
+    SimpleEvaluator::parseLeaf(leaf, label, inverseLabel);
+    const bool reverse = inverseLabel != transposed;
+    auto &matrix = reverse ? inverse[label] : forward[label];
+    if (matrix == nullptr) {
+        auto built = std::make_shared<BoolMatrix>(BoolMatrix::fromIndex(graph->getIndex(label, reverse), graph->getNoVertices()));
+        built->indexRows();
+        matrix = std::move(built);
+    }
+    return matrix;
+}
+
+std::shared_ptr<const BoolMatrix> MatrixEvaluator::closureMatrix(RPQTree *q, bool transposed,
+                                                                 const std::vector<uint32_t> *sources) {
+    const bool reflexive = q->data == "*";
+
+    // the transpose of a closure is the closure of the transpose
+    if (q->left->isLeaf()) {
+        auto step = labelMatrix(q->left, transposed);
+        return std::make_shared<BoolMatrix>(step->closure(reflexive, sources, &threadPool));
+    }
+
+    std::vector<RPQTree *> innerSteps;
+    flatten(q->left, innerSteps);
+    auto step = evaluatePath(innerSteps, transposed, ANY_VERTEX);
+    return std::make_shared<BoolMatrix>(step->closure(reflexive, sources, &threadPool));
+}
+
+std::shared_ptr<const BoolMatrix> MatrixEvaluator::evaluatePath(std::vector<RPQTree *> &steps, bool transposed,
+                                                                uint32_t source) {
+    std::shared_ptr<const BoolMatrix> current;
+
+    for (size_t k = 0; k < steps.size(); ++k) {
+        RPQTree *step = transposed ? steps[steps.size() - 1 - k] : steps[k];
+
+        if (step->isLeaf()) {
+            if (current != nullptr) {
+                current = std::make_shared<BoolMatrix>(BoolMatrix::multiply(*current, *labelMatrix(step, transposed), &threadPool));
+            } else if (source != ANY_VERTEX) {
+                uint32_t label;
+                bool inverseLabel;
+                SimpleEvaluator::parseLeaf(step, label, inverseLabel);
+                current = std::make_shared<BoolMatrix>(BoolMatrix::fromIndex(
+                        graph->getIndex(label, inverseLabel != transposed), graph->getNoVertices(), source));
+            } else {
+                current = labelMatrix(step, transposed);
+            }
+            continue;
+        }
+
+        // only the rows the path can have reached so far are computed
+        std::vector<uint32_t> sources;
+        const std::vector<uint32_t> *reached = nullptr;
+        if (current != nullptr) {
+            sources = current->columnIds();
+            reached = &sources;
+        } else if (source != ANY_VERTEX) {
+            sources.push_back(source);
+            reached = &sources;
+        }
+
+        auto closure = closureMatrix(step, transposed, reached);
+        if (current != nullptr) {
+            current = std::make_shared<BoolMatrix>(BoolMatrix::multiply(*current, *closure, &threadPool));
+        } else {
+            current = closure;
+        }
+    }
+
+    return current;
+}
+
+cardStat MatrixEvaluator::evaluate(RPQTree *query) {
+    return evaluate(query, ANY_VERTEX, ANY_VERTEX);
+}
+
+cardStat MatrixEvaluator::evaluate(RPQTree *query, uint32_t source, uint32_t target) {
+    // a constant that is not a vertex of the graph matches nothing
+    if ((source != ANY_VERTEX && source >= graph->getNoVertices()) ||
+        (target != ANY_VERTEX && target >= graph->getNoVertices())) {
+        return {0, 0, 0};
+    }
+
+    std::vector<RPQTree *> steps;
+    flatten(query, steps);
+
+    // with only the target bound, evaluate the inverse path from it and swap the endpoints back
+    if (source == ANY_VERTEX && target != ANY_VERTEX) {
+        auto stats = evaluatePath(steps, true, target)->stats();
+        return {stats.noIn, stats.noPaths, stats.noOut};
+    }
+
+    auto result = evaluatePath(steps, false, source);
+    if (target != ANY_VERTEX) {
+        BoolMatrix restricted = *result;
+        restricted.restrictToColumn(target);
+        return restricted.stats();
+    }
+    return result->stats();
+}
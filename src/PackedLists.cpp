@@ -0,0 +1,199 @@
+//
+// Delta-encoded, bit-packed neighbour lists.
+//
+
+#include "PackedLists.h"
+
+#include <algorithm>
+#include <cstring>
+
+// four 32-bit lanes; the compiler maps the shifts and masks below onto SSE2/NEON registers
+typedef uint32_t lanes __attribute__((vector_size(16)));
+
+static inline lanes loadLanes(const uint32_t *in) {
+    lanes v;
+    std::memcpy(&v, in, sizeof(v));
+    return v;
+}
+
+static inline void storeLanes(uint32_t *out, lanes v) {
+    std::memcpy(out, &v, sizeof(v));
+}
+
+// every width has its own fully unrolled kernel, so that all shifts are constants
+template <uint32_t W>
+static void unpackWidth(const uint32_t *in, uint32_t *values) {
+    if (W == 0) {
+        std::fill(values, values + PACKED_BLOCK_SIZE, 0);
+        return;
+    }
+    const lanes mask = lanes{} + (W == 32 ? ~0u : (1u << (W % 32)) - 1);
+    lanes word = loadLanes(in);
+    uint32_t shift = 0;
+    for (uint32_t row = 0; row < PACKED_BLOCK_SIZE / 4; ++row) {
+        lanes value = word >> shift;
+        if (shift + W > 32) {
+            in += 4;
+            word = loadLanes(in);
+            value |= word << (32 - shift);
+            shift = shift + W - 32;
+        } else if (shift + W == 32) {
+            shift = 0;
+            if (row + 1 < PACKED_BLOCK_SIZE / 4) {
+                in += 4;
+                word = loadLanes(in);
+            }
+        } else {
+            shift += W;
+        }
+        storeLanes(values + 4 * row, value & mask);
+    }
+}
+
+static void (*const UNPACKERS[33])(const uint32_t *, uint32_t *) = {
+    &unpackWidth<0>, &unpackWidth<1>, &unpackWidth<2>, &unpackWidth<3>, &unpackWidth<4>, &unpackWidth<5>,
+    &unpackWidth<6>, &unpackWidth<7>, &unpackWidth<8>, &unpackWidth<9>, &unpackWidth<10>, &unpackWidth<11>,
+    &unpackWidth<12>, &unpackWidth<13>, &unpackWidth<14>, &unpackWidth<15>, &unpackWidth<16>, &unpackWidth<17>,
+    &unpackWidth<18>, &unpackWidth<19>, &unpackWidth<20>, &unpackWidth<21>, &unpackWidth<22>, &unpackWidth<23>,
+    &unpackWidth<24>, &unpackWidth<25>, &unpackWidth<26>, &unpackWidth<27>, &unpackWidth<28>, &unpackWidth<29>,
+    &unpackWidth<30>, &unpackWidth<31>, &unpackWidth<32>
+};
+
+void unpackBlock(const uint32_t *in, uint32_t width, uint32_t *values) {
+    UNPACKERS[width](in, values);
+}
+
+void packBlock(const uint32_t *values, uint32_t width, uint32_t *out) {
+    if (width == 0) return;
+    for (uint32_t lane = 0; lane < 4; ++lane) {
+        uint64_t buffer = 0;
+        uint32_t bits = 0, word = 0;
+        for (uint32_t row = 0; row < PACKED_BLOCK_SIZE / 4; ++row) {
+            buffer |= static_cast<uint64_t>(values[4 * row + lane]) << bits;
+            bits += width;
+            if (bits >= 32) {
+                out[4 * word++ + lane] = static_cast<uint32_t>(buffer);
+                buffer >>= 32;
+                bits -= 32;
+            }
+        }
+    }
+}
+
+uint32_t packedWidth(const uint32_t *values) {
+    uint32_t any = 0;
+    for (size_t i = 0; i < PACKED_BLOCK_SIZE; ++i) any |= values[i];
+    return any == 0 ? 0 : 32 - __builtin_clz(any);
+}
+
+// appends one block of (zero-padded) values to words
+static void appendBlock(std::vector<uint32_t> &words, const uint32_t *values, std::vector<uint32_t> &blocks,
+                        std::vector<uint8_t> &widths) {
+    const uint32_t width = packedWidth(values);
+    blocks.push_back(static_cast<uint32_t>(words.size()));
+    widths.push_back(static_cast<uint8_t>(width));
+    words.resize(words.size() + 4 * width);
+    packBlock(values, width, words.data() + blocks.back());
+}
+
+static inline uint32_t zigzag(uint32_t target, uint32_t v) {
+    const auto difference = static_cast<int32_t>(target - v);
+    return (static_cast<uint32_t>(difference) << 1) ^ static_cast<uint32_t>(difference >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t value, uint32_t v) {
+    return v + ((value >> 1) ^ (0u - (value & 1)));
+}
+
+std::shared_ptr<PackedLists> PackedLists::pack(const uint32_t *offsets, const uint32_t *targets, uint32_t noVertices) {
+    auto packed = std::make_shared<PackedLists>();
+    packed->noVertices = noVertices;
+    packed->noValues = offsets[noVertices];
+
+    uint32_t block[PACKED_BLOCK_SIZE];
+    for (uint32_t first = 0; first < noVertices; first += PACKED_BLOCK_SIZE) {
+        // the vertices past the last one get its end, which offset(noVertices) reads in a partial group
+        for (uint32_t i = 0; i < PACKED_BLOCK_SIZE; ++i) {
+            block[i] = offsets[std::min<uint64_t>(noVertices, uint64_t(first) + i)] - offsets[first];
+        }
+        packed->groupPositionStorage.push_back(offsets[first]);
+        appendBlock(packed->wordStorage, block, packed->offsetBlockStorage, packed->offsetWidthStorage);
+    }
+    packed->groupPositionStorage.push_back(packed->noValues);
+
+    size_t filled = 0;
+    for (uint32_t v = 0; v < noVertices; ++v) {
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+            block[filled++] = i == offsets[v] ? zigzag(targets[i], v) : targets[i] - targets[i - 1] - 1;
+            if (filled == PACKED_BLOCK_SIZE) {
+                appendBlock(packed->wordStorage, block, packed->valueBlockStorage, packed->valueWidthStorage);
+                filled = 0;
+            }
+        }
+    }
+    if (filled > 0) {
+        std::fill(block + filled, block + PACKED_BLOCK_SIZE, 0);
+        appendBlock(packed->wordStorage, block, packed->valueBlockStorage, packed->valueWidthStorage);
+    }
+
+    packed->wordStorage.shrink_to_fit();
+    packed->noWords = static_cast<uint32_t>(packed->wordStorage.size());
+    packed->words = packed->wordStorage.data();
+    packed->groupPositions = packed->groupPositionStorage.data();
+    packed->offsetBlocks = packed->offsetBlockStorage.data();
+    packed->offsetWidths = packed->offsetWidthStorage.data();
+    packed->valueBlocks = packed->valueBlockStorage.data();
+    packed->valueWidths = packed->valueWidthStorage.data();
+    return packed;
+}
+
+bool PackedLists::isConsistent() const {
+    auto fits = [this](uint32_t block, uint8_t width) {
+        return width <= 32 && uint64_t(block) + 4 * width <= noWords;
+    };
+    for (uint32_t g = 0; g < noGroups(); ++g) {
+        if (!fits(offsetBlocks[g], offsetWidths[g]) || groupPositions[g] > groupPositions[g + 1]) return false;
+    }
+    for (uint32_t b = 0; b < noValueBlocks(); ++b) {
+        if (!fits(valueBlocks[b], valueWidths[b])) return false;
+    }
+    return groupPositions[noGroups()] == noValues;
+}
+
+size_t PackedLists::memoryUsage() const {
+    return sizeof(PackedLists) + (size_t(noWords) + 2 * size_t(noGroups()) + 1 + noValueBlocks()) * sizeof(uint32_t) +
+           noGroups() + noValueBlocks();
+}
+
+// runs at least this long are unpacked a block at a time rather than read value by value
+static const uint32_t MIN_UNPACKED_RUN = 16;
+
+PackedReader::PackedReader(const PackedLists &lists) : lists(&lists), block(SIZE_MAX), next(UINT32_MAX), end(UINT32_MAX) {}
+
+const std::vector<uint32_t> &PackedReader::neighbours(uint32_t v) {
+    uint32_t position = v == next ? end : lists->offset(v);
+    const uint32_t n = lists->offset(v + 1) - position;
+    const bool sequential = position == end;
+    next = v + 1;
+    end = position + n;
+
+    // undo the gap encoding while reading the stream
+    list.resize(n);
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < n; ) {
+        const size_t b = position / PACKED_BLOCK_SIZE;
+        const uint32_t offset = position % PACKED_BLOCK_SIZE;
+        const uint32_t count = std::min<uint32_t>(n - i, PACKED_BLOCK_SIZE - offset);
+        if (b != block && (sequential || count >= MIN_UNPACKED_RUN)) {
+            unpackBlock(lists->words + lists->valueBlocks[b], lists->valueWidths[b], values);
+            block = b;
+        }
+        for (uint32_t k = 0; k < count; ++k, ++i) {
+            const uint32_t value = b == block ? values[offset + k] : lists->value(position + k);
+            previous = i == 0 ? unzigzag(value, v) : previous + value + 1;
+            list[i] = previous;
+        }
+        position += count;
+    }
+    return list;
+}
@@ -0,0 +1,180 @@
+//
+// Workload-driven index of materialized short label paths.
+//
+
+#include "PathIndex.h"
+#include "SimpleEstimator.h"
+#include "SimpleEvaluator.h"
+
+#include <algorithm>
+#include <chrono>
+
+// only the most frequent paths are weighed against each other
+static const size_t MAX_CANDIDATES = 32;
+static const uint64_t MIN_FREQUENCY = 2;
+
+std::string PathIndexAdvisor::key(const query_path &steps) {
+    std::string key;
+    for (const auto &step : steps) {
+        key += std::to_string(step.label);
+        key += step.forward ? '+' : '-';
+    }
+    return key;
+}
+
+void PathIndexAdvisor::record(const query_path &path, uint64_t times) {
+    for (size_t i = 0; i < path.size(); ++i) {
+        for (size_t length = 1; length <= MAX_PATH_LENGTH && i + length <= path.size(); ++length) {
+            if (path[i + length - 1].isClosure()) break;
+            if (length < MIN_PATH_LENGTH) continue;
+            query_path steps(path.begin() + i, path.begin() + i + length);
+            auto k = key(steps);
+            auto &candidate = counts[k];
+            if (candidate.frequency == 0) candidate = {k, steps, 0};
+            candidate.frequency += times;
+        }
+    }
+}
+
+std::vector<PathCandidate> PathIndexAdvisor::candidates() const {
+    std::vector<PathCandidate> frequent;
+    for (const auto &keyCandidatePair : counts) {
+        if (keyCandidatePair.second.frequency >= MIN_FREQUENCY) frequent.push_back(keyCandidatePair.second);
+    }
+    std::sort(frequent.begin(), frequent.end(), [](const PathCandidate &a, const PathCandidate &b) {
+        if (a.frequency != b.frequency) return a.frequency > b.frequency;
+        return a.key < b.key;
+    });
+    if (frequent.size() > MAX_CANDIDATES) frequent.resize(MAX_CANDIDATES);
+    return frequent;
+}
+
+// bytes of the forward and reverse CSR indexes of a path with the given number of pairs
+static size_t indexBytes(uint32_t noVertices, uint64_t noPairs) {
+    return (2 * (size_t(noVertices) + 1) + 2 * noPairs) * sizeof(uint32_t);
+}
+
+void PathIndexAdvisor::estimate(const SimpleGraph &base, const query_path &steps, uint64_t &work, size_t &bytes) {
+    // every join step multiplies the pairs by the average degree of its label
+    const double V = std::max<uint32_t>(base.getNoVertices(), 1);
+    double pairs = base.getIndex(steps[0].label, !steps[0].forward).noTargets;
+    double total = pairs;
+    for (size_t k = 1; k < steps.size(); ++k) {
+        pairs *= base.getIndex(steps[k].label, !steps[k].forward).noTargets / V;
+        total += pairs;
+    }
+    work = static_cast<uint64_t>(total);
+    bytes = indexBytes(base.getNoVertices(), static_cast<uint64_t>(pairs));
+}
+
+std::shared_ptr<const MaterializedPath> PathIndexAdvisor::materialize(std::shared_ptr<SimpleGraph> &base, const query_path &steps,
+                                                                      size_t limit) {
+    auto path = std::make_shared<MaterializedPath>();
+    const uint32_t V = base->getNoVertices();
+
+    // an intermediate that already outgrows the limit is abandoned before it is joined any further
+    auto result = SimpleEvaluator::project(steps[0].label, !steps[0].forward, base);
+    path->work = result->targets.size();
+    if (indexBytes(V, result->targets.size()) > limit) return nullptr;
+    for (size_t k = 1; k < steps.size(); ++k) {
+        result = SimpleEvaluator::join(result, steps[k].label, !steps[k].forward, base);
+        path->work += result->targets.size();
+        if (indexBytes(V, result->targets.size()) > limit) return nullptr;
+    }
+
+    // the result already is the forward index, but for the offsets of the sources without destinations
+    auto &offsets = path->forward.offsetStorage;
+    offsets.assign(size_t(V) + 1, 0);
+    for (size_t i = 0; i < result->size(); ++i) {
+        offsets[result->sources[i] + 1] = result->degree(i);
+    }
+    for (uint32_t v = 0; v < V; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(result->targets.size());
+    for (size_t i = 0; i < result->size(); ++i) {
+        for (auto target = result->begin(i); target != result->end(i); ++target) {
+            edges.emplace_back(result->sources[i], *target);
+        }
+    }
+    SimpleGraph::buildAdjacency(edges, true, V, path->reverse);
+
+    path->forward.targetStorage = std::move(result->targets);
+    path->forward.offsets = offsets.data();
+    path->forward.targets = path->forward.targetStorage.data();
+    path->forward.noTargets = static_cast<uint32_t>(path->forward.targetStorage.size());
+    path->bytes = indexBytes(V, edges.size());
+    return path;
+}
+
+std::shared_ptr<PathIndex> PathIndexAdvisor::build(std::shared_ptr<SimpleGraph> base, const std::vector<PathCandidate> &candidates,
+                                                   size_t budget) {
+    auto start = std::chrono::steady_clock::now();
+
+    // the paths of the previous generation are weighed by their real size, the others by an estimate,
+    // so nothing is evaluated before it is known to be worth its bytes
+    struct Option {
+        const PathCandidate *candidate;
+        std::shared_ptr<const MaterializedPath> path;
+        uint64_t work;
+        size_t bytes;
+    };
+    std::vector<Option> options;
+    for (const auto &candidate : candidates) {
+        Option option {&candidate, nullptr, 0, 0};
+        auto search = materialized.find(candidate.key);
+        if (search != materialized.end()) {
+            option.path = search->second;
+            option.work = option.path->work;
+            option.bytes = option.path->bytes;
+        } else {
+            estimate(*base, candidate.steps, option.work, option.bytes);
+        }
+        options.push_back(option);
+    }
+
+    // greedy knapsack on the work saved per byte
+    auto value = [](const Option &option) {
+        return double(option.candidate->frequency) * double(option.work) / double(std::max<size_t>(option.bytes, 1));
+    };
+    std::sort(options.begin(), options.end(), [&](const Option &a, const Option &b) {
+        return value(a) > value(b);
+    });
+
+    // materialized in order of value, each within what is left of the budget, and dropped right away if
+    // it turns out larger than estimated
+    auto index = std::make_shared<PathIndex>();
+    std::unordered_map<std::string, std::shared_ptr<const MaterializedPath>> kept;
+    for (const auto &option : options) {
+        if (index->bytes >= budget) break;
+        const size_t remaining = budget - index->bytes;
+        if (option.work == 0 || option.bytes > remaining) continue;
+        auto path = option.path != nullptr ? option.path : materialize(base, option.candidate->steps, remaining);
+        if (path == nullptr || path->work == 0 || path->bytes > remaining) continue;
+        index->bytes += path->bytes;
+        kept[option.candidate->key] = path;
+        if (labelOffsets.emplace(option.candidate->key, paths.size()).second) {
+            paths.push_back(option.candidate->key);
+        }
+    }
+    materialized = std::move(kept);
+
+    index->buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    index->base = base;
+    index->noBaseLabels = base->getNoLabels();
+    index->paths = paths;
+    index->graph = SimpleGraph::extend(*base, static_cast<uint32_t>(paths.size()));
+    for (const auto &keyPathPair : materialized) {
+        const uint32_t label = index->noBaseLabels + labelOffsets[keyPathPair.first];
+        for (bool inverse : {false, true}) {
+            const auto &original = inverse ? keyPathPair.second->reverse : keyPathPair.second->forward;
+            auto &view = inverse ? index->graph->reverseIndex[label] : index->graph->forwardIndex[label];
+            view.view(original);
+        }
+        index->labels[keyPathPair.first] = label;
+        index->indexes.push_back(keyPathPair.second);
+    }
+    return index;
+}
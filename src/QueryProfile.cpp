@@ -0,0 +1,147 @@
+//
+// Per-operator execution profiles of query evaluation.
+//
+
+#include "QueryProfile.h"
+#include "Json.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+QueryProfiler::QueryProfiler() : epoch(std::chrono::steady_clock::now()) {}
+
+double QueryProfiler::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+uint32_t QueryProfiler::beginQuery(const std::string &description) {
+    QueryRecord query {description, now(), 0};
+    std::lock_guard<std::mutex> lock(mutex);
+    queries.push_back(query);
+    return static_cast<uint32_t>(queries.size() - 1);
+}
+
+void QueryProfiler::endQuery(uint32_t query) {
+    const double end = now();
+    std::lock_guard<std::mutex> lock(mutex);
+    queries[query].end = end;
+}
+
+void QueryProfiler::record(OperatorProfile op) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto thread = threads.emplace(std::this_thread::get_id(), static_cast<uint32_t>(threads.size())).first;
+    op.thread = thread->second;
+    operators.push_back(std::move(op));
+}
+
+void QueryProfiler::setEstimate(const std::string &key, double noPaths) {
+    std::lock_guard<std::mutex> lock(mutex);
+    estimates[key] = noPaths;
+}
+
+double QueryProfiler::estimate(const std::string &key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto search = estimates.find(key);
+    return search != estimates.end() ? search->second : -1;
+}
+
+std::vector<QueryRecord> QueryProfiler::getQueries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queries;
+}
+
+std::vector<OperatorProfile> QueryProfiler::getOperators() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return operators;
+}
+
+void QueryProfiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    queries.clear();
+    operators.clear();
+    estimates.clear();
+}
+
+// max(estimate / actual, actual / estimate), with empty results counted as one path
+static double qError(double estimate, uint64_t actual) {
+    const double e = std::max(1.0, estimate);
+    const double a = std::max<double>(1.0, actual);
+    return std::max(e / a, a / e);
+}
+
+void QueryProfiler::writeChromeTrace(std::ostream &out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // the queries are async spans on track 0, since those of a batch overlap; thread n is track n + 1
+    std::ostringstream trace;
+    trace << std::fixed << std::setprecision(3);
+    trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    trace << R"({"name":"thread_name","ph":"M","pid":1,"tid":0,"args":{"name":"queries"}})";
+    for (const auto &idThreadPair : threads) {
+        trace << ",\n" << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << idThreadPair.second + 1
+              << R"(,"args":{"name":"thread )" << idThreadPair.second << "\"}}";
+    }
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const auto &query = queries[q];
+        trace << ",\n{\"name\":" << jsonString(query.description) << R"(,"cat":"query","ph":"b","id":)" << q
+              << R"(,"pid":1,"tid":0,"ts":)" << query.start << '}';
+        trace << ",\n{\"name\":" << jsonString(query.description) << R"(,"cat":"query","ph":"e","id":)" << q
+              << R"(,"pid":1,"tid":0,"ts":)" << std::max(query.start, query.end) << '}';
+    }
+    for (const auto &op : operators) {
+        trace << ",\n{\"name\":" << jsonString(op.name) << R"(,"cat":"operator","ph":"X","pid":1,"tid":)" << op.thread + 1
+              << ",\"ts\":" << op.start << ",\"dur\":" << op.end - op.start
+              << ",\"args\":{\"query\":" << op.query << ",\"path\":" << jsonString(op.path)
+              << ",\"leftInput\":" << op.leftInput << ",\"rightInput\":" << op.rightInput
+              << ",\"output\":" << op.output << ",\"bytes\":" << op.bytes;
+        if (op.estimate >= 0) {
+            trace << ",\"estimate\":" << op.estimate << ",\"qError\":" << qError(op.estimate, op.output);
+        }
+        trace << "}}";
+    }
+    trace << "\n]}\n";
+    out << trace.str();
+}
+
+void QueryProfiler::printSummary(std::ostream &out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::vector<const OperatorProfile *>> byQuery(queries.size());
+    for (const auto &op : operators) {
+        if (op.query < queries.size()) byQuery[op.query].push_back(&op);
+    }
+
+    // formatted on the side, so that the stream keeps its own flags
+    std::ostringstream table;
+    table << std::fixed;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        auto &ops = byQuery[q];
+        std::stable_sort(ops.begin(), ops.end(), [](const OperatorProfile *a, const OperatorProfile *b) {
+            return a->start < b->start;
+        });
+        const auto &query = queries[q];
+        table << "\nQuery " << q << ": " << query.description << " (" << std::setprecision(3)
+              << (query.end - query.start) / 1000 << " ms, " << ops.size() << " operators)\n";
+        if (ops.empty()) continue;
+
+        table << std::left << std::setw(9) << "operator" << std::setw(28) << " path" << std::right
+              << std::setw(7) << "thread" << std::setw(11) << "start ms" << std::setw(11) << "time ms"
+              << std::setw(12) << "left in" << std::setw(12) << "right in" << std::setw(12) << "output"
+              << std::setw(13) << "estimate" << std::setw(9) << "q-error" << std::setw(11) << "KiB" << '\n';
+        for (const auto *op : ops) {
+            table << std::left << std::setw(9) << op->name << ' ' << std::setw(27) << op->path << std::right
+                  << std::setw(7) << op->thread << std::setprecision(3)
+                  << std::setw(11) << (op->start - query.start) / 1000 << std::setw(11) << (op->end - op->start) / 1000
+                  << std::setw(12) << op->leftInput << std::setw(12) << op->rightInput << std::setw(12) << op->output;
+            if (op->estimate >= 0) {
+                table << std::setprecision(0) << std::setw(13) << op->estimate << std::setprecision(2)
+                      << std::setw(9) << qError(op->estimate, op->output);
+            } else {
+                table << std::setw(13) << '-' << std::setw(9) << '-';
+            }
+            table << std::setw(11) << op->bytes / 1024 << '\n';
+        }
+    }
+    out << table.str();
+}
@@ -37,6 +37,16 @@ RPQTree* RPQTree::strToTree(std::string &str) {
         }
     }
 
+    // case closure
+    // postfix '*' or '+' on a parenthesized subquery or a label, e.g. (0+/1-)* or 0-+
+    // (a '+' right after a digit is the direction of a label instead)
+    size_t n = str.size();
+    if(n >= 2 && (str[n-1] == '*' || (str[n-1] == '+' && !isdigit(str[n-2])))){
+        std::string sub(str.substr(0, n-1));
+        std::string payload(1, str[n-1]);
+        return new RPQTree(payload, strToTree(sub), nullptr);
+    }
+
     if(str[0]=='('){
         //case ()
         //pull out inside and to strToTree
@@ -79,6 +89,10 @@ bool RPQTree::isConcat() {
     return (data == "/") && isBinary();
 }
 
+bool RPQTree::isClosure() {
+    return (data == "*" || data == "+") && isUnary();
+}
+
 bool RPQTree::isBinary() {
     return left != nullptr && right != nullptr;
 }
@@ -0,0 +1,127 @@
+//
+// Semi-join reduction of path queries.
+//
+
+#include "SemiJoinReducer.h"
+#include "SimpleEstimator.h"
+#include "SimpleEvaluator.h"
+
+bool SemiJoinReducer::image(const SimpleGraph &g, const PathStep &step, bool backwards, const VertexSet &from,
+                            VertexSet &to) {
+    uint32_t label;
+    bool inverse;
+    if (step.isClosure()) {
+        if (!step.closure->left->isLeaf()) return false;
+        SimpleEvaluator::parseLeaf(step.closure->left, label, inverse);
+    } else {
+        label = step.label;
+        inverse = false;
+    }
+    NeighbourReader neighbours(g.getIndex(label, inverse != (!step.forward != backwards)));
+
+    std::vector<uint32_t> frontier;
+    for (size_t w = 0; w < from.size(); ++w) {
+        for (uint64_t word = from[w]; word != 0; word &= word - 1) {
+            frontier.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+        }
+    }
+
+    if (!step.isClosure()) {
+        for (auto v : frontier) {
+            for (auto n : neighbours(v)) insert(to, n);
+        }
+        return true;
+    }
+
+    // every vertex reachable in one or more steps, and the start vertices themselves for '*'
+    if (step.closure->data == "*") to = from;
+    std::vector<uint32_t> next;
+    while (!frontier.empty()) {
+        next.clear();
+        for (auto v : frontier) {
+            for (auto n : neighbours(v)) {
+                if (contains(to, n)) continue;
+                insert(to, n);
+                next.push_back(n);
+            }
+        }
+        std::swap(frontier, next);
+    }
+    return true;
+}
+
+ReducedQuery SemiJoinReducer::reduce(const SimpleGraph &g, const query_path &path, uint32_t source, uint32_t target) {
+    const uint32_t V = g.getNoVertices();
+    const size_t n = path.size();
+
+    auto fill = [V](VertexSet &set, uint32_t bound) {
+        if (bound != ANY_VERTEX) {
+            insert(set, bound);
+            return;
+        }
+        std::fill(set.begin(), set.end(), ~uint64_t(0));
+        if (V % 64 != 0) set[V / 64] = (uint64_t(1) << (V % 64)) - 1;
+        else set[V / 64] = 0;
+    };
+
+    // at[k]: the vertices that can sit between step k-1 and step k
+    std::vector<VertexSet> at(n + 1, VertexSet(V / 64 + 1, 0));
+    fill(at[0], source);
+    for (size_t k = 0; k < n; ++k) {
+        if (!image(g, path[k], false, at[k], at[k + 1])) fill(at[k + 1], ANY_VERTEX);
+    }
+
+    VertexSet reached(V / 64 + 1, 0);
+    fill(reached, target);
+    for (size_t w = 0; w < reached.size(); ++w) at[n][w] &= reached[w];
+    for (size_t k = n; k-- > 0; ) {
+        std::fill(reached.begin(), reached.end(), 0);
+        if (!image(g, path[k], true, at[k + 1], reached)) fill(reached, ANY_VERTEX);
+        for (size_t w = 0; w < reached.size(); ++w) at[k][w] &= reached[w];
+    }
+
+    ReducedQuery reduced;
+    for (const auto &set : at) {
+        if (std::none_of(set.begin(), set.end(), [](uint64_t word) { return word != 0; })) {
+            reduced.empty = true;
+            return reduced;
+        }
+    }
+
+    // the original labels share the original indexes
+    const uint32_t L = g.getNoLabels();
+    size_t noLabelSteps = std::count_if(path.begin(), path.end(), [](const PathStep &step) { return !step.isClosure(); });
+    reduced.graph = SimpleGraph::extend(g, static_cast<uint32_t>(noLabelSteps));
+
+    // every label step is a view of its label that keeps the edges between surviving vertices of its two
+    // positions; only the edges are counted, nothing is copied
+    std::vector<std::shared_ptr<const VertexSet>> positions;
+    for (auto &set : at) positions.push_back(std::make_shared<const VertexSet>(std::move(set)));
+    uint32_t nextLabel = L;
+    for (size_t k = 0; k < n; ++k) {
+        if (path[k].isClosure()) {
+            reduced.stepLabels.push_back(UINT32_MAX);
+            continue;
+        }
+        auto &forward = reduced.graph->forwardIndex[nextLabel];
+        auto &reverse = reduced.graph->reverseIndex[nextLabel];
+        forward.view(g.getIndex(path[k].label, !path[k].forward));
+        forward.sourceFilter = positions[k];
+        forward.targetFilter = positions[k + 1];
+        reverse.view(g.getIndex(path[k].label, path[k].forward));
+        reverse.sourceFilter = positions[k + 1];
+        reverse.targetFilter = positions[k];
+
+        NeighbourReader neighbours(forward);
+        uint32_t noEdges = 0;
+        for (size_t w = 0; w < positions[k]->size(); ++w) {
+            for (uint64_t word = (*positions[k])[w]; word != 0; word &= word - 1) {
+                noEdges += static_cast<uint32_t>(neighbours(static_cast<uint32_t>(w * 64 + __builtin_ctzll(word))).size());
+            }
+        }
+        forward.noTargets = reverse.noTargets = noEdges;
+        reduced.stepLabels.push_back(nextLabel++);
+    }
+
+    return reduced;
+}
@@ -9,46 +9,66 @@
 #include <random>
 
 SimpleEstimator::SimpleEstimator(std::shared_ptr<SimpleGraph> &g) :
-    vertexIndexByLabel(),
-    vertexIndexByLabelReverse(),
     outVertexByLabel(),
-    inVertexByLabel() {
+    inVertexByLabel(),
+    allSketch() {
 
     // works only with SimpleGraph
     graph = g;
 }
 
 void SimpleEstimator::prepare() {
-    std::unordered_set<uint32_t> outVertex, inVertex;
+    outVertexByLabel.assign(graph->getNoLabels(), {});
+    inVertexByLabel.assign(graph->getNoLabels(), {});
     for (uint32_t label = 0; label < graph->getNoLabels(); ++label) {
-        outVertex.clear();
-        inVertex.clear();
-        for (const auto &edge : graph->edgeLists[label]) {
-            vertexIndexByLabel       [label][edge.first].emplace_back(edge.second);
-            vertexIndexByLabelReverse[label][edge.second].emplace_back(edge.first);
-
-            // create sets of unique out and in vertices
-            outVertex.insert(edge.first);
-            inVertex.insert(edge.second);
+        NeighbourReader forward(graph->getIndex(label, false));
+        NeighbourReader reverse(graph->getIndex(label, true));
+        for (uint32_t v = 0; v < graph->getNoVertices(); ++v) {
+            // the graph indexes are deduplicated, so these are the unique out and in vertices
+            if (forward.degree(v) > 0) outVertexByLabel[label].push_back(v);
+            if (reverse.degree(v) > 0) inVertexByLabel[label].push_back(v);
         }
+    }
 
-        // now copy unique vertices to vector for indexed access
-        for (const auto vout : outVertex) {
-            outVertexByLabel[label].push_back(vout);
-        }
-        for (const auto vin : inVertex) {
-            inVertexByLabel[label].push_back(vin);
-        }
+    // every vertex starts a path through a '*' closure
+    allVertices.clear();
+    for (uint32_t v = 0; v < graph->getNoVertices(); allVertices.push_back(v++));
+
+    outSketches.assign(graph->getNoLabels(), DistinctSketch());
+    inSketches.assign(graph->getNoLabels(), DistinctSketch());
+    for (uint32_t label = 0; label < graph->getNoLabels(); ++label) {
+        for (auto v : outVertexByLabel[label]) outSketches[label].add(v);
+        for (auto v : inVertexByLabel[label]) inSketches[label].add(v);
+    }
+    allSketch.clear();
+    for (auto v : allVertices) allSketch.add(v);
+}
+
+size_t SimpleEstimator::memoryUsage() const {
+    size_t bytes = sizeof(*this) + allVertices.capacity() * sizeof(uint32_t) + allSketch.memoryUsage();
+    for (const auto *byLabel : {&outVertexByLabel, &inVertexByLabel}) {
+        bytes += byLabel->capacity() * sizeof(std::vector<uint32_t>);
+        for (const auto &vertices : *byLabel) bytes += vertices.capacity() * sizeof(uint32_t);
+    }
+    for (const auto *sketches : {&outSketches, &inSketches}) {
+        bytes += sketches->capacity() * sizeof(DistinctSketch);
+        for (const auto &sketch : *sketches) bytes += sketch.memoryUsage();
     }
+    return bytes;
 }
 
-void SimpleEstimator::unpackQueryTree(std::vector<std::pair<uint32_t, bool>> *path, RPQTree *q) {
+void SimpleEstimator::unpackQueryTree(query_path *path, RPQTree *q) {
     if (q->isConcat()) {
         unpackQueryTree(path, q->left);
         unpackQueryTree(path, q->right);
         return;
     }
 
+    if (q->isClosure()) {
+        path->emplace_back(q);
+        return;
+    }
+
     char* sign;
     const auto label = static_cast<uint32_t>(strtoll(q->data.c_str(), &sign, 10));
     path->emplace_back(label, *sign == '+');
@@ -100,24 +120,24 @@ double SimpleEstimator::generateSampling(std::vector<uint32_t> *from, std::vecto
     return (double) from->size() / sampleSize;
 }
 
-double SimpleEstimator::indexBasedJoinSampling(std::unordered_map<uint32_t, std::vector<uint32_t>> *index,
+double SimpleEstimator::indexBasedJoinSampling(const AdjacencyIndex &index,
                                                std::vector<uint32_t> *from, std::vector<uint32_t> *to,
                                                uint32_t sampleSize) {
+    NeighbourReader neighbours(index);
     std::vector<uint32_t> sampleIds;
     uint32_t cpt = 0;
     std::vector<uint32_t> cptPerVertex;
 
     for (uint32_t i = 0; i < from->size(); ++i) {
         auto fromVertex = (*from)[i];
-        auto image = (*index)[fromVertex];
-        cpt += image.size();
+        cpt += neighbours.degree(fromVertex);
         cptPerVertex.push_back(cpt);
     }
 
     if (cpt <= sampleSize) {
         // the entire join fits in the sampling, skip expensive stuff and just return the image
         for (auto fromVertex : *from) {
-            for (auto toVertex : (*index)[fromVertex]) {
+            for (auto toVertex : neighbours(fromVertex)) {
                 to->push_back(toVertex);
             }
         }
@@ -142,22 +162,197 @@ double SimpleEstimator::indexBasedJoinSampling(std::unordered_map<uint32_t, std:
         else
             offset = ID;
 
-        to->push_back((*index)[(*from)[fromVertexIndex]][offset]);
+        to->push_back(neighbours((*from)[fromVertexIndex]).begin()[offset]);
+    }
+
+    return (double) cpt / sampleSize;
+}
+
+query_path SimpleEstimator::innerPath(const PathStep &step) {
+    query_path inner;
+    unpackQueryTree(&inner, step.closure->left);
+    if (!step.forward) {
+        invertPath(inner);
+    }
+    return inner;
+}
+
+void SimpleEstimator::invertPath(query_path &path) {
+    std::reverse(path.begin(), path.end());
+    for (auto &step : path) {
+        step.forward = !step.forward;
+    }
+}
+
+std::vector<uint32_t> *SimpleEstimator::startVertices(const PathStep &step) {
+    if (!step.isClosure()) {
+        return step.forward ? &outVertexByLabel[step.label] : &inVertexByLabel[step.label];
+    }
+    if (step.closure->data == "*") {
+        return &allVertices;
+    }
+    return startVertices(innerPath(step)[0]);
+}
+
+DistinctSketch SimpleEstimator::sourceDomain(const PathStep &step) {
+    if (!step.isClosure()) {
+        return step.forward ? outSketches[step.label] : inSketches[step.label];
+    }
+    if (step.closure->data == "*") {
+        return allSketch;
+    }
+    return sourceDomain(innerPath(step)[0]);
+}
+
+DistinctSketch SimpleEstimator::targetDomain(const PathStep &step, const DistinctSketch &previous) {
+    if (!step.isClosure()) {
+        return step.forward ? inSketches[step.label] : outSketches[step.label];
+    }
+
+    // every repetition of the subquery ends in the domain of its last step
+    DistinctSketch domain = previous;
+    for (const auto &innerStep : innerPath(step)) {
+        domain = targetDomain(innerStep, domain);
+    }
+    // a '*' closure also keeps the vertices it started from
+    if (step.closure->data == "*") {
+        domain.merge(previous);
+    }
+    return domain;
+}
+
+double SimpleEstimator::expectedDistinct(double noPaths, double domain) {
+    if (domain < 1) return 0;
+    return domain * -std::expm1(noPaths * std::log1p(-1 / std::max(domain, 2.0)));
+}
+
+void SimpleEstimator::pathImage(const query_path &path, std::vector<uint32_t> &vertices, uint32_t limit) {
+    std::vector<uint32_t> image;
+    for (const auto &step : path) {
+        if (vertices.empty()) return;
+        if (step.isClosure()) {
+            closureImage(step, vertices, limit);
+            continue;
+        }
+
+        NeighbourReader neighbours(graph->getIndex(step.label, !step.forward));
+        image.clear();
+        for (auto v : vertices) {
+            auto range = neighbours(v);
+            image.insert(image.end(), range.begin(), range.end());
+        }
+        std::sort(image.begin(), image.end());
+        image.erase(std::unique(image.begin(), image.end()), image.end());
+        if (image.size() > limit) image.resize(limit);
+        vertices.swap(image);
+    }
+}
+
+void SimpleEstimator::closureImage(const PathStep &step, std::vector<uint32_t> &vertices, uint32_t limit) {
+    query_path inner = innerPath(step);
+
+    std::unordered_set<uint32_t> reached;
+    if (step.closure->data == "*") {
+        reached.insert(vertices.begin(), vertices.end());
+    }
+
+    // repeat the subquery until nothing new is reached (or the image gets too large to matter)
+    std::vector<uint32_t> frontier = vertices, fresh;
+    while (!frontier.empty() && reached.size() < limit) {
+        pathImage(inner, frontier, limit);
+        fresh.clear();
+        for (auto v : frontier) {
+            if (reached.insert(v).second) fresh.push_back(v);
+        }
+        frontier.swap(fresh);
+    }
+
+    vertices.assign(reached.begin(), reached.end());
+}
+
+double SimpleEstimator::closureSampling(const PathStep &step, std::vector<uint32_t> *from, std::vector<uint32_t> *to,
+                                        uint32_t sampleSize) {
+    const uint32_t MAX_CLOSURE_IMAGE = 8192;
+
+    std::unordered_map<uint32_t, std::vector<uint32_t>> images;
+    std::vector<uint32_t> cptPerVertex;
+    uint32_t cpt = 0;
+    for (auto fromVertex : *from) {
+        auto search = images.find(fromVertex);
+        if (search == images.end()) {
+            std::vector<uint32_t> image { fromVertex };
+            closureImage(step, image, MAX_CLOSURE_IMAGE);
+            search = images.emplace(fromVertex, std::move(image)).first;
+        }
+        cpt += search->second.size();
+        cptPerVertex.push_back(cpt);
+    }
+
+    if (cpt <= sampleSize) {
+        for (auto fromVertex : *from) {
+            for (auto toVertex : images[fromVertex]) {
+                to->push_back(toVertex);
+            }
+        }
+        return 1.0;
+    }
+
+    std::vector<uint32_t> sampleIds;
+    generateSampleIds(cpt, &sampleIds, sampleSize);
+    for (auto ID : sampleIds) {
+        auto fromVertexIndex = std::upper_bound(cptPerVertex.begin(), cptPerVertex.end(), ID) - cptPerVertex.begin();
+        uint32_t offset = fromVertexIndex > 0 ? ID - cptPerVertex[fromVertexIndex - 1] : ID;
+        to->push_back(images[(*from)[fromVertexIndex]][offset]);
     }
 
     return (double) cpt / sampleSize;
 }
 
 cardStat SimpleEstimator::estimate(RPQTree *q) {
-    auto path = std::vector<std::pair<uint32_t, bool>>();
+    return estimate(q, ANY_VERTEX, ANY_VERTEX);
+}
+
+cardStat SimpleEstimator::estimate(RPQTree *q, uint32_t source, uint32_t target) {
+    query_path path;
     unpackQueryTree(&path, q);
 
-    return estimate_aux(path);
+    return estimate_aux(path, source, target);
 }
 
-cardStat SimpleEstimator::estimate_aux(std::vector<std::pair<uint32_t, bool>> path) {
+cardStat SimpleEstimator::estimate_aux(query_path path, uint32_t source, uint32_t target) {
     if (path.empty()) { return {0, 0, 0}; }
 
+    // only the target is bound: estimate the inverse path starting from the target instead
+    if (source == ANY_VERTEX && target != ANY_VERTEX) {
+        invertPath(path);
+        cardStat inverseEst = estimatePrefixes(path, target).back();
+        return {inverseEst.noIn, inverseEst.noPaths, inverseEst.noOut};
+    }
+
+    return estimatePrefixes(path, source, target).back();
+}
+
+std::vector<cardStat> SimpleEstimator::estimateSuffixes(query_path path, uint32_t target) {
+    if (path.empty()) { return {}; }
+
+    invertPath(path);
+    auto inverseEst = estimatePrefixes(path, target);
+
+    // the inverse prefix of length k is the suffix starting at n-k
+    std::vector<cardStat> suffixes;
+    for (auto it = inverseEst.rbegin(); it != inverseEst.rend(); ++it) {
+        suffixes.push_back({it->noIn, it->noPaths, it->noOut});
+    }
+    return suffixes;
+}
+
+std::vector<cardStat> SimpleEstimator::estimatePrefixes(query_path path, uint32_t source, uint32_t target) {
+    if (path.empty()) { return {}; }
+    if ((source != ANY_VERTEX && source >= graph->getNoVertices()) ||
+        (target != ANY_VERTEX && target >= graph->getNoVertices())) {
+        return std::vector<cardStat>(path.size(), {0, 0, 0});
+    }
+
     std::srand(222);
 
 
@@ -167,37 +362,67 @@ cardStat SimpleEstimator::estimate_aux(std::vector<std::pair<uint32_t, bool>> pa
     double underSampling;
     uint32_t MAX_SAMPLING = 64;
 
-    // generate uniform sampling of the outVertices for the first label
-    if (path[0].second) {
-        underSampling = generateSampling(&outVertexByLabel[path[0].first], leftSamples, MAX_SAMPLING);
+    if (source != ANY_VERTEX) {
+        // a bound source is the only starting point, no sampling needed
+        leftSamples->push_back(source);
+        underSampling = 1.0;
     } else {
-        underSampling = generateSampling(&inVertexByLabel[path[0].first], leftSamples, MAX_SAMPLING);
+        // generate uniform sampling of the vertices the first step can start from
+        underSampling = generateSampling(startVertices(path[0]), leftSamples, MAX_SAMPLING);
     }
 
-    std::unordered_map<uint32_t, std::vector<uint32_t>> *mapping;
+    std::vector<cardStat> prefixes;
+
+    // distinct sources and targets are bounded by the domains of the path endpoints
+    DistinctSketch domain = source != ANY_VERTEX ? DistinctSketch() : sourceDomain(path[0]);
+    const double sourceDomainSize = domain.estimate();
+    DistinctSketch frontier(10);
+
     // evaluate the query along the query path
-    for (auto step : path) {
-        // take either the forwards or backwards index of the current label, depending on the direction
-        if (step.second) {
-            mapping = &vertexIndexByLabel[step.first];
+    for (const auto &step : path) {
+        if (step.isClosure()) {
+            underSampling *= closureSampling(step, leftSamples, rightSamples, MAX_SAMPLING);
         } else {
-            mapping = &vertexIndexByLabelReverse[step.first];
+            // take either the forwards or backwards index of the current label, depending on the direction,
+            // calculate the image of the mapping, and update the new underSampling factor
+            const auto &index = graph->getIndex(step.label, !step.forward);
+            underSampling *= indexBasedJoinSampling(index, leftSamples, rightSamples, MAX_SAMPLING);
         }
 
-        // calculate the image of the mapping, and update the new underSampling factor
-        underSampling *= indexBasedJoinSampling(mapping, leftSamples, rightSamples, MAX_SAMPLING);
-
         // mapping image becomes pre-image for the next step, image vector is cleared.
         auto t = leftSamples;
         leftSamples = rightSamples;
         rightSamples = t;
         rightSamples->clear();
+
+        auto noPaths = static_cast<uint32_t>(leftSamples->size() * underSampling);
+
+        // bound endpoints: at most one source (and one target, for the full path)
+        if (source != ANY_VERTEX) {
+            if (target != ANY_VERTEX && prefixes.size() + 1 == path.size()) {
+                bool reachesTarget = std::find(leftSamples->begin(), leftSamples->end(), target) != leftSamples->end();
+                noPaths = reachesTarget ? 1 : 0;
+            }
+            prefixes.push_back({noPaths > 0 ? 1u : 0u, noPaths, noPaths});
+        } else {
+            domain = targetDomain(step, domain);
+
+            // the sampled targets are all real, so they bound noIn from below
+            frontier.clear();
+            for (auto v : *leftSamples) frontier.add(v);
+            const double reached = std::min<double>(std::round(frontier.estimate()), noPaths);
+            const double paths = noPaths;
+            // without any sampling down the sample holds every path, and so every target
+            const double noIn = underSampling == 1.0 ? reached
+                              : std::min(std::max(expectedDistinct(paths, domain.estimate()), reached), paths);
+            const double noOut = std::min(std::max(expectedDistinct(paths, sourceDomainSize), paths > 0 ? 1.0 : 0.0), paths);
+            prefixes.push_back({static_cast<uint32_t>(std::round(noOut)), static_cast<uint32_t>(paths),
+                                static_cast<uint32_t>(std::round(noIn))});
+        }
     }
 
-    // return {1, (image size * undersampling), 1}
-    // since we have no calculation for noIn and noOut.
-    auto noPaths = static_cast<uint32_t>(leftSamples->size() * underSampling);
     delete leftSamples;
     delete rightSamples;
-    return {static_cast<uint32_t>(noPaths / underSampling), noPaths, static_cast<uint32_t>(underSampling)};
+
+    return prefixes;
 }
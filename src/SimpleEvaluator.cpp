@@ -3,11 +3,23 @@
 //
 
 #include "SimpleEstimator.h"
+#include "SemiJoinReducer.h"
 #include "SimpleEvaluator.h"
+#include "SortedSets.h"
+
+#include <chrono>
+#include <limits>
+#include <unordered_set>
+
+// default byte budget of the intermediate result cache
+static const size_t DEFAULT_CACHE_BUDGET = size_t(1) << 30;
+// queries recorded between two background builds of the path index
+static const size_t PATH_INDEX_REBUILD_INTERVAL = 16;
 
 
 SimpleEvaluator::SimpleEvaluator(std::shared_ptr<SimpleGraph> &g) :
-    evalCache(), statCache(), threadPool(8) {
+    evalCache(DEFAULT_CACHE_BUDGET), statCache(), threadPool(), semiJoinReduction(false),
+    pathIndexBudget(0), recordedSinceBuild(0), profiledQuery(0) {
 
     // works only with SimpleGraph
     graph = g;
@@ -18,12 +30,111 @@ void SimpleEvaluator::attachEstimator(std::shared_ptr<SimpleEstimator> &e) {
     est = e;
 }
 
+void SimpleEvaluator::setCacheBudget(size_t bytes) {
+    evalCache.setBudget(bytes);
+}
+
+void SimpleEvaluator::setSemiJoinReduction(bool enabled) {
+    semiJoinReduction = enabled;
+}
+
+void SimpleEvaluator::setProfiler(std::shared_ptr<QueryProfiler> p) {
+    profiler = std::move(p);
+}
+
+// times one operator for the profiler of an evaluator, if it has one
+class OperatorTimer {
+    QueryProfiler *profiler;
+    OperatorProfile op;
+
+public:
+    OperatorTimer(QueryProfiler *profiler, uint32_t query, const char *name, const std::string &key,
+                  uint64_t leftInput = 0, uint64_t rightInput = 0) : profiler(profiler) {
+        if (profiler == nullptr) return;
+        op.query = query;
+        op.name = name;
+        op.path = key;
+        op.leftInput = leftInput;
+        op.rightInput = rightInput;
+        op.estimate = profiler->estimate(key);
+        op.start = profiler->now();
+    }
+
+    // a result that was not allocated by the operator (a cache hit) adds no bytes
+    std::shared_ptr<intermediate> finish(std::shared_ptr<intermediate> result, bool allocated = true) {
+        if (profiler == nullptr) return result;
+        op.end = profiler->now();
+        op.output = result->targets.size();
+        op.bytes = allocated ? memoryUsage(*result) : 0;
+        profiler->record(std::move(op));
+        return result;
+    }
+
+    cardStat finish(cardStat stats) {
+        if (profiler == nullptr) return stats;
+        op.end = profiler->now();
+        op.output = stats.noPaths;
+        profiler->record(std::move(op));
+        return stats;
+    }
+};
+
+static uint64_t noPaths(const std::shared_ptr<intermediate> &result) {
+    return result != nullptr ? result->targets.size() : 0;
+}
+
+static uint64_t noEdges(const std::shared_ptr<SimpleGraph> &g, uint32_t label, bool inverse) {
+    return g->getIndex(label, inverse).noTargets;
+}
+
+void SimpleEvaluator::setPathIndexBudget(size_t bytes) {
+    pathIndexBudget = bytes;
+}
+
 void SimpleEvaluator::prepare() {
 
     // if attached, prepare the estimator
     if(est != nullptr) est->prepare();
 
-    // prepare other things here.., if necessary
+    // materialize the paths of the workload recorded so far
+    if (pathIndexBudget > 0 && !pathAdvisor.empty()) rebuildPathIndex();
+}
+
+void SimpleEvaluator::installPathIndex(std::shared_ptr<PathIndex> index) {
+    pathIndex = std::move(index);
+    graph = pathIndex->graph;
+    std::cout << "\nPath index: " << pathIndex->labels.size() << " paths in "
+              << pathIndex->bytes / (1 << 20) << " MiB, built in " << pathIndex->buildTime << " ms" << std::endl;
+}
+
+void SimpleEvaluator::rebuildPathIndex() {
+    // a build that is still running is superseded, though the paths it materialized are reused
+    if (pendingPathIndex.valid()) pendingPathIndex.get();
+    auto base = pathIndex != nullptr ? pathIndex->base : graph;
+    auto next = pathAdvisor.build(base, pathAdvisor.candidates(), pathIndexBudget);
+    recordedSinceBuild = 0;
+    installPathIndex(std::move(next));
+}
+
+void SimpleEvaluator::updatePathIndex() {
+    if (pathIndexBudget == 0) return;
+
+    if (pendingPathIndex.valid() &&
+        pendingPathIndex.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        installPathIndex(pendingPathIndex.get());
+    }
+
+    // the build runs on its own thread, off the pool that evaluates the queries meanwhile
+    if (!pendingPathIndex.valid() && recordedSinceBuild >= PATH_INDEX_REBUILD_INTERVAL) {
+        recordedSinceBuild = 0;
+        auto advisor = &pathAdvisor;
+        auto base = pathIndex != nullptr ? pathIndex->base : graph;
+        auto budget = pathIndexBudget;
+        auto candidates = pathAdvisor.candidates();
+        pendingPathIndex = std::async(std::launch::async, [advisor, base, candidates, budget]() {
+            return advisor->build(base, candidates, budget);
+        });
+    }
 }
 
 cardStat SimpleEvaluator::computeStats(std::shared_ptr<intermediate> &result) {
@@ -32,258 +143,1426 @@ cardStat SimpleEvaluator::computeStats(std::shared_ptr<intermediate> &result) {
 
     stats.noOut = static_cast<uint32_t>(result->size());
 
-    std::unordered_set<uint32_t> uniqueDests;
+    // every operator produces sorted, duplicate-free destination lists, so only noIn needs a set
+    std::vector<uint64_t> destBitset(graph->getNoVertices() / 64 + 1, 0);
+    stats.noPaths = static_cast<uint32_t>(result->targets.size());
+    for (auto dest : result->targets) {
+        destBitset[dest / 64] |= uint64_t(1) << (dest % 64);
+    }
 
-    uint32_t length = graph->getNoVertices() / sizeof(uint8_t) + 1;
-    auto *destBitset = static_cast<uint8_t *>(malloc(length));
-    for (uint32_t i = 0; i < length; ++i) { destBitset[i] = 0; }
+    for (auto word : destBitset) {
+        stats.noIn += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
 
-    for (auto sourceDestListPair : *result) {
-        std::sort(sourceDestListPair.second.begin(), sourceDestListPair.second.end());
-        bool first = true;
-        uint32_t prevDest = 0;
-        for (const auto &dest: sourceDestListPair.second) {
+    return stats;
+}
 
-            // dest = 12
-            // dest / 8 = 1
-            // dest % 8 = 4
+// collects the union of the destination lists of one source at a time without duplicates,
+// so intermediates stay bounded by the number of (source, destination) pairs rather than paths.
+// The first few lists are merged with the vectorized sorted-set union; once more lists arrive the
+// destinations are marked in a bitset instead, and only the ones added since are sorted in the end.
+class DestinationSet {
+    static const size_t MERGED_LISTS = 4;
+
+    std::vector<uint64_t> bits;
+    std::vector<uint32_t> merged;
+    size_t noLists = 0;
+    // dests[0 .. noSorted) is sorted while marking
+    size_t noSorted = 0;
+
+    void mark(uint32_t dest) { bits[dest / 64] |= uint64_t(1) << (dest % 64); }
+
+    void unite(const uint32_t *first, size_t n, const uint32_t *second, size_t m, std::vector<uint32_t> &dests) {
+        merged.resize(n + m + SORTED_SET_PADDING);
+        merged.resize(sortedUnion(first, n, second, m, merged.data()));
+        dests.swap(merged);
+    }
 
-            // 0123 4567   0123 4
-            // 0           1    v      2
-            // 0000 0000   0000 1000   0000 0000
+public:
+    explicit DestinationSet(uint32_t noVertices) : bits(noVertices / 64 + 1, 0) {}
+
+    // lists must be sorted and duplicate-free
+    void add(const uint32_t *first, const uint32_t *last, std::vector<uint32_t> &dests) {
+        if (noLists < MERGED_LISTS) {
+            ++noLists;
+            if (dests.empty()) {
+                dests.assign(first, last);
+            } else {
+                unite(dests.data(), dests.size(), first, last - first, dests);
+            }
+            return;
+        }
+        if (noLists == MERGED_LISTS) {
+            ++noLists;
+            for (auto dest : dests) mark(dest);
+            noSorted = dests.size();
+        }
+        for (; first != last; ++first) {
+            auto &word = bits[*first / 64];
+            uint64_t mask = uint64_t(1) << (*first % 64);
+            if (!(word & mask)) {
+                word |= mask;
+                dests.push_back(*first);
+            }
+        }
+    }
+
+    // sort the collected destinations and clear their marks for the next source
+    void finish(std::vector<uint32_t> &dests) {
+        if (noLists > MERGED_LISTS) {
+            for (auto dest : dests) {
+                bits[dest / 64] &= ~(uint64_t(1) << (dest % 64));
+            }
+            std::sort(dests.begin() + noSorted, dests.end());
+            unite(dests.data(), noSorted, dests.data() + noSorted, dests.size() - noSorted, dests);
+        }
+        noLists = 0;
+    }
+};
+
+// operator inputs are split into morsels of at least MIN_MORSEL_SIZE sources,
+// a few morsels per worker so that uneven morsels still balance out
+static const size_t MIN_MORSEL_SIZE = 1024;
+static const size_t MORSELS_PER_WORKER = 4;
+
+static size_t noMorsels(WorkStealingPool *pool, size_t inputSize) {
+    if (pool == nullptr) return 1;
+    return std::max<size_t>(1, std::min(pool->size() * MORSELS_PER_WORKER, inputSize / MIN_MORSEL_SIZE));
+}
+
+static void forEachMorsel(WorkStealingPool *pool, size_t n, const std::function<void(size_t)> &body) {
+    if (pool == nullptr || n == 1) {
+        for (size_t morsel = 0; morsel < n; ++morsel) body(morsel);
+        return;
+    }
+    pool->parallelFor(n, body);
+}
+
+// first and last (exclusive) item of a morsel
+static size_t morselBegin(size_t morsel, size_t n, size_t size) { return size * morsel / n; }
+static size_t morselEnd(size_t morsel, size_t n, size_t size) { return size * (morsel + 1) / n; }
+
+// receives the sorted, duplicate-free destination list of one source at a time, in ascending source order
+// within a morsel; every morsel writes its own partition, and as morsels cover consecutive source ranges
+// the partitions are simply concatenated at the end
+class IntermediateSink {
+    intermediate &out;
+    std::vector<intermediate> partitions;
+
+public:
+    explicit IntermediateSink(intermediate &out) : out(out) {}
+
+    void begin(size_t noMorsels) {
+        partitions.assign(noMorsels, intermediate());
+    }
 
-            destBitset[dest / 8] |= 1 << (dest % 8);
+    void add(size_t morsel, uint32_t source, const uint32_t *first, const uint32_t *last) {
+        partitions[morsel].append(source, first, last);
+    }
+
+    void finish() {
+        if (partitions.size() == 1) {
+            std::swap(out, partitions[0]);
+            return;
+        }
+        size_t noSources = 0, noTargets = 0;
+        for (const auto &partition : partitions) {
+            noSources += partition.size();
+            noTargets += partition.targets.size();
+        }
+        out.sources.reserve(noSources);
+        out.offsets.reserve(noSources + 1);
+        out.targets.reserve(noTargets);
+        for (auto &partition : partitions) {
+            out.append(partition);
+            partition = intermediate();
+        }
+    }
+};
+
+// counts the join output instead of storing it; noIn is the popcount of all destinations
+class StatSink {
+    std::vector<cardStat> partitions;
+    std::vector<std::atomic<uint64_t>> targets;
+
+public:
+    explicit StatSink(uint32_t noVertices) : targets(noVertices / 64 + 1) {
+        for (auto &word : targets) word.store(0, std::memory_order_relaxed);
+    }
+
+    void begin(size_t noMorsels) {
+        partitions.assign(noMorsels, {0, 0, 0});
+    }
+
+    void add(size_t morsel, uint32_t /*source*/, const uint32_t *first, const uint32_t *last) {
+        ++partitions[morsel].noOut;
+        partitions[morsel].noPaths += static_cast<uint32_t>(last - first);
+        for (; first != last; ++first) {
+            targets[*first / 64].fetch_or(uint64_t(1) << (*first % 64), std::memory_order_relaxed);
+        }
+    }
+
+    cardStat finish() {
+        cardStat stats {0, 0, 0};
+        for (const auto &partition : partitions) {
+            stats.noOut += partition.noOut;
+            stats.noPaths += partition.noPaths;
+        }
+        for (const auto &word : targets) {
+            stats.noIn += static_cast<uint32_t>(__builtin_popcountll(word.load(std::memory_order_relaxed)));
+        }
+        return stats;
+    }
+};
 
-            if (first || dest != prevDest) {
-                stats.noPaths++;
-                first = false;
-                prevDest = dest;
+std::shared_ptr<intermediate> SimpleEvaluator::project(uint32_t projectLabel, bool inverse, std::shared_ptr<SimpleGraph> &in,
+                                                       uint32_t source, uint32_t target, WorkStealingPool *pool) {
+
+    auto out = std::make_shared<intermediate>();
+
+    const auto &index = in->getIndex(projectLabel, inverse);
+    NeighbourReader neighbours(index);
+
+    // bound source: a single neighbour range, optionally filtered on the target
+    if (source != ANY_VERTEX) {
+        auto range = neighbours(source);
+        if (target != ANY_VERTEX) {
+            if (std::binary_search(range.begin(), range.end(), target)) {
+                out->append(source, &target, &target + 1);
             }
+        } else {
+            out->append(source, range.begin(), range.end());
         }
+        return out;
     }
 
-    for (uint32_t  i = 0; i < length; ++i) {
-        for (uint32_t  j = 0; j < 8; ++j) {
-            if (destBitset[i] & 1 << j) stats.noIn++;
+    // bound target: look the sources up in the opposite direction
+    if (target != ANY_VERTEX) {
+        NeighbourReader reverse(in->getIndex(projectLabel, !inverse));
+        for (auto s : reverse(target)) {
+            out->append(s, &target, &target + 1);
         }
+        return out;
     }
 
-    delete destBitset;
+    // the whole label, in morsels of vertex ranges
+    const uint32_t noVertices = in->getNoVertices();
+    const size_t n = noMorsels(pool, noVertices);
+    if (index.isPacked() || index.isFiltered()) {
+        IntermediateSink sink(*out);
+        sink.begin(n);
+        forEachMorsel(pool, n, [&](size_t morsel) {
+            NeighbourReader reader(index);
+            for (auto v = static_cast<uint32_t>(morselBegin(morsel, n, noVertices)); v < morselEnd(morsel, n, noVertices); ++v) {
+                auto range = reader(v);
+                if (!range.empty()) sink.add(morsel, v, range.begin(), range.end());
+            }
+        });
+        sink.finish();
+        return out;
+    }
 
-    return stats;
+    // a plain index is the CSR minus its empty rows: every morsel counts its sources, then copies its rows
+    // and targets into place
+    std::vector<size_t> firstSource(n + 1, 0);
+    forEachMorsel(pool, n, [&](size_t morsel) {
+        size_t count = 0;
+        for (size_t v = morselBegin(morsel, n, noVertices); v < morselEnd(morsel, n, noVertices); ++v) {
+            if (index.offsets[v + 1] != index.offsets[v]) ++count;
+        }
+        firstSource[morsel + 1] = count;
+    });
+    for (size_t morsel = 0; morsel < n; ++morsel) firstSource[morsel + 1] += firstSource[morsel];
+
+    out->sources.resize(firstSource[n]);
+    out->offsets.resize(firstSource[n] + 1);
+    out->targets.resize(index.noTargets);
+    forEachMorsel(pool, n, [&](size_t morsel) {
+        const size_t begin = morselBegin(morsel, n, noVertices), end = morselEnd(morsel, n, noVertices);
+        std::copy(index.targets + index.offsets[begin], index.targets + index.offsets[end],
+                  out->targets.begin() + index.offsets[begin]);
+        size_t i = firstSource[morsel];
+        for (size_t v = begin; v < end; ++v) {
+            if (index.offsets[v + 1] == index.offsets[v]) continue;
+            out->sources[i] = static_cast<uint32_t>(v);
+            out->offsets[++i] = index.offsets[v + 1];
+        }
+    });
+
+    return out;
+}
+
+// the joins below run over morsels of the left sources: positions in a materialized left side,
+// or vertex ranges of a left label
+template <typename Sink>
+static void joinInto(intermediate &left, intermediate &right, std::shared_ptr<SimpleGraph> &g, Sink &sink,
+                     WorkStealingPool *pool) {
+
+    const size_t n = noMorsels(pool, left.size());
+    sink.begin(n);
+    forEachMorsel(pool, n, [&](size_t morsel) {
+        DestinationSet destSet(g->getNoVertices());
+        std::vector<uint32_t> dests;
+        for (size_t i = morselBegin(morsel, n, left.size()); i < morselEnd(morsel, n, left.size()); ++i) {
+            for (auto leftDest = left.begin(i); leftDest != left.end(i); ++leftDest) {
+                size_t j = right.find(*leftDest);
+                if (j == right.size()) continue;
+                destSet.add(right.begin(j), right.end(j), dests);
+            }
+            if (dests.empty()) continue;
+            destSet.finish(dests);
+            sink.add(morsel, left.sources[i], dests.data(), dests.data() + dests.size());
+            dests.clear();
+        }
+    });
+}
+
+// below this many target in-neighbours per left destination, probing beats intersecting the lists
+static const size_t INTERSECT_RATIO = 16;
+
+template <typename Sink>
+static void joinInto(intermediate &left, uint32_t rightLabel, bool rightInverse, std::shared_ptr<SimpleGraph> &g,
+                     uint32_t target, Sink &sink, WorkStealingPool *pool) {
+
+    const auto &index = g->getIndex(rightLabel, rightInverse);
+    // the vertices with an edge to a bound target
+    std::vector<uint32_t> targetSourceList;
+    if (target != ANY_VERTEX) {
+        NeighbourReader reverse(g->getIndex(rightLabel, !rightInverse));
+        auto range = reverse(target);
+        targetSourceList.assign(range.begin(), range.end());
+    }
+    const uint32_t *targetSources = targetSourceList.data();
+    const size_t noTargetSources = targetSourceList.size();
+
+    const size_t n = noMorsels(pool, left.size());
+    sink.begin(n);
+    forEachMorsel(pool, n, [&](size_t morsel) {
+        NeighbourReader neighbours(index);
+        DestinationSet destSet(target == ANY_VERTEX ? g->getNoVertices() : 0);
+        std::vector<uint32_t> dests, common;
+        for (size_t i = morselBegin(morsel, n, left.size()); i < morselEnd(morsel, n, left.size()); ++i) {
+            // bound target: a source qualifies if one of its destinations has an edge to the target; short
+            // destination lists probe the neighbours of each, lists comparable in size to the target's
+            // in-neighbours are intersected with them
+            if (target != ANY_VERTEX) {
+                const size_t noLeftDests = left.degree(i);
+                bool qualifies = false;
+                if (noLeftDests * INTERSECT_RATIO < noTargetSources) {
+                    for (auto leftDest = left.begin(i); leftDest != left.end(i); ++leftDest) {
+                        auto range = neighbours(*leftDest);
+                        if (std::binary_search(range.begin(), range.end(), target)) {
+                            qualifies = true;
+                            break;
+                        }
+                    }
+                } else {
+                    common.resize(std::min(noLeftDests, noTargetSources) + SORTED_SET_PADDING);
+                    qualifies = sortedIntersection(left.begin(i), noLeftDests,
+                                                   targetSources, noTargetSources, common.data()) > 0;
+                }
+                if (qualifies) {
+                    sink.add(morsel, left.sources[i], &target, &target + 1);
+                }
+                continue;
+            }
+
+            for (auto leftDest = left.begin(i); leftDest != left.end(i); ++leftDest) {
+                auto range = neighbours(*leftDest);
+                destSet.add(range.begin(), range.end(), dests);
+            }
+            if (dests.empty()) continue;
+            destSet.finish(dests);
+            sink.add(morsel, left.sources[i], dests.data(), dests.data() + dests.size());
+            dests.clear();
+        }
+    });
+}
+template <typename Sink>
+static void joinInto(uint32_t leftLabel, bool leftInverse, intermediate &right, std::shared_ptr<SimpleGraph> &g,
+                     uint32_t source, Sink &sink, WorkStealingPool *pool) {
+
+    const auto &index = g->getIndex(leftLabel, leftInverse);
+
+    // bound source: only its own neighbour range is joined
+    uint32_t firstSource = 0, lastSource = g->getNoVertices();
+    // when set, only these sources (sorted) are joined instead of the range
+    std::vector<uint32_t> candidates;
+    bool useCandidates = false;
+    if (source != ANY_VERTEX) {
+        firstSource = source;
+        lastSource = source + 1;
+    } else {
+        // every source with an edge into the right side meets the same destination lists either way, so a
+        // scan of every edge of the label only pays off against collecting those sources first, walking
+        // backwards over the reverse index from the right sources (e.g. when the right side is bound to a target)
+        NeighbourReader reverse(g->getIndex(leftLabel, !leftInverse));
+        uint64_t backwardEdges = 0;
+        for (auto rightSource : right.sources) {
+            backwardEdges += reverse.degree(rightSource);
+        }
+
+        if (backwardEdges < index.noTargets) {
+            candidates.reserve(backwardEdges);
+            for (auto rightSource : right.sources) {
+                auto range = reverse(rightSource);
+                candidates.insert(candidates.end(), range.begin(), range.end());
+            }
+            std::sort(candidates.begin(), candidates.end());
+            candidates.resize(sortedDedup(candidates.data(), candidates.size()));
+            useCandidates = true;
+        }
+    }
+
+    const size_t noSources = useCandidates ? candidates.size() : lastSource - firstSource;
+    const size_t n = noMorsels(pool, noSources);
+    sink.begin(n);
+    forEachMorsel(pool, n, [&](size_t morsel) {
+        NeighbourReader neighbours(index);
+        DestinationSet destSet(g->getNoVertices());
+        std::vector<uint32_t> dests;
+        for (size_t k = morselBegin(morsel, n, noSources); k < morselEnd(morsel, n, noSources); ++k) {
+            const uint32_t source = useCandidates ? candidates[k] : firstSource + static_cast<uint32_t>(k);
+            for (auto leftDest : neighbours(source)) {
+                size_t j = right.find(leftDest);
+                if (j == right.size()) continue;
+                destSet.add(right.begin(j), right.end(j), dests);
+            }
+            if (dests.empty()) continue;
+            destSet.finish(dests);
+            sink.add(morsel, source, dests.data(), dests.data() + dests.size());
+            dests.clear();
+        }
+    });
+}
+
+std::shared_ptr<intermediate> SimpleEvaluator::join(std::shared_ptr<intermediate> &left, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                                                    WorkStealingPool *pool) {
+    auto out = std::make_shared<intermediate>();
+    IntermediateSink sink(*out);
+    joinInto(*left, *right, g, sink, pool);
+    sink.finish();
+    return out;
 }
 
-std::shared_ptr<intermediate> SimpleEvaluator::project(uint32_t projectLabel, bool inverse, std::shared_ptr<SimpleGraph> &in) {
+std::shared_ptr<intermediate> SimpleEvaluator::join(std::shared_ptr<intermediate> &left, uint32_t rightLabel, bool rightInverse, std::shared_ptr<SimpleGraph> &g,
+                                                    uint32_t target, WorkStealingPool *pool) {
+    auto out = std::make_shared<intermediate>();
+    IntermediateSink sink(*out);
+    joinInto(*left, rightLabel, rightInverse, g, target, sink, pool);
+    sink.finish();
+    return out;
+}
 
+std::shared_ptr<intermediate> SimpleEvaluator::join(uint32_t leftLabel, bool leftInverse, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                                                    uint32_t source, WorkStealingPool *pool) {
     auto out = std::make_shared<intermediate>();
+    IntermediateSink sink(*out);
+    joinInto(leftLabel, leftInverse, *right, g, source, sink, pool);
+    sink.finish();
+    return out;
+}
 
-    if (!inverse) {
-        for (const auto &sourceDestPair : in->edgeLists[projectLabel]) {
-            (*out)[sourceDestPair.first].emplace_back(sourceDestPair.second);
+cardStat SimpleEvaluator::joinStats(std::shared_ptr<intermediate> &left, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                                    WorkStealingPool *pool) {
+    StatSink sink(g->getNoVertices());
+    joinInto(*left, *right, g, sink, pool);
+    return sink.finish();
+}
+
+cardStat SimpleEvaluator::joinStats(std::shared_ptr<intermediate> &left, uint32_t rightLabel, bool rightInverse, std::shared_ptr<SimpleGraph> &g,
+                                    uint32_t target, WorkStealingPool *pool) {
+    StatSink sink(g->getNoVertices());
+    joinInto(*left, rightLabel, rightInverse, g, target, sink, pool);
+    return sink.finish();
+}
+
+cardStat SimpleEvaluator::joinStats(uint32_t leftLabel, bool leftInverse, std::shared_ptr<intermediate> &right, std::shared_ptr<SimpleGraph> &g,
+                                    uint32_t source, WorkStealingPool *pool) {
+    StatSink sink(g->getNoVertices());
+    joinInto(leftLabel, leftInverse, *right, g, source, sink, pool);
+    return sink.finish();
+}
+
+std::shared_ptr<intermediate> SimpleEvaluator::closure(RPQTree *q, std::shared_ptr<intermediate> &inner, std::shared_ptr<SimpleGraph> &g,
+                                                       uint32_t source, uint32_t target, WorkStealingPool *pool) {
+
+    bool reflexive = q->data == "*";
+
+    // with only the target bound, search backwards from it over the inverse relation
+    bool backwards = source == ANY_VERTEX && target != ANY_VERTEX;
+
+    // the step relation: a label is read from the graph index, a subquery result is indexed first
+    AdjacencyIndex innerIndex;
+    const AdjacencyIndex *step = &innerIndex;
+    if (q->left->isLeaf()) {
+        uint32_t label;
+        bool inverse;
+        parseLeaf(q->left, label, inverse);
+        step = &g->getIndex(label, inverse != backwards);
+    } else if (backwards) {
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (size_t i = 0; i < inner->size(); ++i) {
+            for (auto dest = inner->begin(i); dest != inner->end(i); ++dest) {
+                edges.emplace_back(inner->sources[i], *dest);
+            }
         }
+        SimpleGraph::buildAdjacency(edges, true, g->getNoVertices(), innerIndex);
     } else {
-        for (const auto &sourceDestPair : in->edgeLists[projectLabel]) {
-            (*out)[sourceDestPair.second].emplace_back(sourceDestPair.first);
+        // the flat result already is a CSR index over its own sources, only the empty rows are missing
+        innerIndex.offsetStorage.assign(g->getNoVertices() + 1, 0);
+        for (size_t i = 0; i < inner->size(); ++i) {
+            innerIndex.offsetStorage[inner->sources[i] + 1] = inner->offsets[i + 1];
+        }
+        for (uint32_t v = 0; v < g->getNoVertices(); ++v) {
+            innerIndex.offsetStorage[v + 1] = std::max(innerIndex.offsetStorage[v + 1], innerIndex.offsetStorage[v]);
+        }
+        innerIndex.offsets = innerIndex.offsetStorage.data();
+        innerIndex.targets = inner->targets.data();
+        innerIndex.noTargets = static_cast<uint32_t>(inner->targets.size());
+    }
+
+    if (backwards) {
+        auto reached = transitiveClosure(*step, reflexive, g->getNoVertices(), target, pool);
+        auto out = std::make_shared<intermediate>();
+        if (!reached->empty()) {
+            for (auto dest = reached->begin(0); dest != reached->end(0); ++dest) {
+                out->append(*dest, &target, &target + 1);
+            }
         }
+        return out;
     }
 
+    auto out = transitiveClosure(*step, reflexive, g->getNoVertices(), source, pool);
+    if (target != ANY_VERTEX) {
+        auto filtered = std::make_shared<intermediate>();
+        for (size_t i = 0; i < out->size(); ++i) {
+            if (std::binary_search(out->begin(i), out->end(i), target)) {
+                filtered->append(out->sources[i], &target, &target + 1);
+            }
+        }
+        return filtered;
+    }
     return out;
 }
 
-std::shared_ptr<intermediate> SimpleEvaluator::join(std::shared_ptr<intermediate> &left, std::shared_ptr<intermediate> &right) {
+std::shared_ptr<intermediate> SimpleEvaluator::transitiveClosure(const AdjacencyIndex &step, bool reflexive, uint32_t noVertices,
+                                                                 uint32_t source, WorkStealingPool *pool) {
 
     auto out = std::make_shared<intermediate>();
 
-    for (const auto &leftSourceDestListPair : *left) { // (source) => (dest vector)
-        for (const auto &leftDest : leftSourceDestListPair.second) {
-            for (const auto &rightDest : (*right)[leftDest]) {
-                (*out)[leftSourceDestListPair.first].emplace_back(rightDest);
+    // a single source keeps the vertices it reached in a hash set rather than a word for every vertex of the graph
+    if (source != ANY_VERTEX) {
+        NeighbourReader neighbours(step);
+        std::unordered_set<uint32_t> visited;
+        std::vector<uint32_t> active {source}, nextActive, reached;
+        while (!active.empty()) {
+            nextActive.clear();
+            for (auto v : active) {
+                for (auto w : neighbours(v)) {
+                    if (visited.insert(w).second) {
+                        reached.push_back(w);
+                        nextActive.push_back(w);
+                    }
+                }
             }
+            std::swap(active, nextActive);
         }
+        if (reflexive && visited.count(source) == 0) reached.push_back(source);
+        std::sort(reached.begin(), reached.end());
+        out->append(source, reached.data(), reached.data() + reached.size());
+        return out;
     }
 
+    std::vector<uint32_t> sources;
+    {
+        NeighbourReader neighbours(step);
+        for (uint32_t v = 0; v < noVertices; ++v) {
+            if (reflexive || neighbours.degree(v) > 0) sources.push_back(v);
+        }
+    }
+
+    // every morsel runs its own batches of 64 sources
+    IntermediateSink sink(*out);
+    const size_t n = noMorsels(pool, sources.size());
+    sink.begin(n);
+    forEachMorsel(pool, n, [&](size_t morsel) {
+        NeighbourReader neighbours(step);
+        // bit i of a vertex's word belongs to the i-th source of the current batch
+        std::vector<uint64_t> visited(noVertices, 0), frontier(noVertices, 0), next(noVertices, 0);
+        std::vector<uint32_t> active, nextActive, reached;
+        std::vector<std::vector<uint32_t>> dests(64);
+        const size_t first = morselBegin(morsel, n, sources.size()), last = morselEnd(morsel, n, sources.size());
+
+        for (size_t batch = first; batch < last; batch += 64) {
+            size_t batchSize = std::min<size_t>(64, last - batch);
+
+            // the sources themselves are only reached again through a cycle (or by reflexivity below)
+            active.clear();
+            reached.clear();
+            for (size_t i = 0; i < batchSize; ++i) {
+                uint32_t v = sources[batch + i];
+                if (frontier[v] == 0) active.push_back(v);
+                frontier[v] |= uint64_t(1) << i;
+            }
+
+            // one sweep per BFS level, moving all sources' frontiers at once
+            while (!active.empty()) {
+                nextActive.clear();
+                for (auto v : active) {
+                    uint64_t bits = frontier[v];
+                    frontier[v] = 0;
+                    for (auto w : neighbours(v)) {
+                        uint64_t fresh = bits & ~visited[w];
+                        if (fresh == 0) continue;
+                        if (visited[w] == 0) reached.push_back(w);
+                        visited[w] |= fresh;
+                        if (next[w] == 0) nextActive.push_back(w);
+                        next[w] |= fresh;
+                    }
+                }
+                std::swap(frontier, next);
+                std::swap(active, nextActive);
+            }
+
+            // visiting the reached vertices in order keeps every destination list sorted
+            std::sort(reached.begin(), reached.end());
+            for (size_t i = 0; i < batchSize; ++i) dests[i].clear();
+            for (auto w : reached) {
+                for (uint64_t bits = visited[w]; bits != 0; bits &= bits - 1) {
+                    dests[__builtin_ctzll(bits)].push_back(w);
+                }
+                visited[w] = 0;
+            }
+
+            for (size_t i = 0; i < batchSize; ++i) {
+                uint32_t v = sources[batch + i];
+                if (reflexive) {
+                    auto position = std::lower_bound(dests[i].begin(), dests[i].end(), v);
+                    if (position == dests[i].end() || *position != v) dests[i].insert(position, v);
+                }
+                sink.add(morsel, v, dests[i].data(), dests[i].data() + dests[i].size());
+            }
+        }
+    });
+    sink.finish();
+
     return out;
 }
 
-std::shared_ptr<intermediate> SimpleEvaluator::evaluate_aux(RPQTree *q) {
+// whether a concatenation with a leaf child joins its subtree with the right leaf (or else with the left leaf);
+// for two leaves the side that carries the bound endpoint is projected and the other is read from the index
+bool SimpleEvaluator::joinsRightLeaf(RPQTree *q, uint32_t source, uint32_t target) {
+    if (q->left->isLeaf() && q->right->isLeaf()) {
+        return !(source == ANY_VERTEX && target != ANY_VERTEX);
+    }
+    return q->right->isLeaf();
+}
+
+void SimpleEvaluator::parseLeaf(RPQTree *leaf, uint32_t &label, bool &inverse) {
+    label = (uint32_t) std::stoul(leaf->data.substr(0, leaf->data.length()-1));
+    inverse = leaf->data.at(leaf->data.length()-1) == '-';
+}
+
+std::shared_ptr<intermediate> SimpleEvaluator::evaluate_aux(RPQTree *q, uint32_t source, uint32_t target) {
     // evaluate cache
     query_path path;
     unpackQueryTree(&path, q);
-    const std::string pathstr = pathToString(&path);
-    auto search = evalCache.find(pathstr);
-    if (search != evalCache.end()) {
+    const std::string pathstr = pathToString(&path, source, target);
+    auto cached = evalCache.get(pathstr);
+    if (cached != nullptr) {
         // cache hit!
         std::cout << '[' << std::string(path.size(), '#') << ']';
-        return search->second;
+        return OperatorTimer(profiler.get(), profiledQuery, "cached", pathstr).finish(cached, false);
     }
     std::cout << '[' << std::string(path.size(), '_') << ']';
     // cache miss..
+    auto start = std::chrono::steady_clock::now();
 
     std::shared_ptr<intermediate> result;
 
     // evaluate according to the AST bottom-up
+    // a bound source applies to the leftmost leaf, a bound target to the rightmost leaf
+    uint32_t label;
+    bool inverse;
+
     if(q->isLeaf()) {
         // project out the label in the AST
-        uint32_t label = (uint32_t) std::stoul(q->data.substr(0, q->data.length()-1));
-        bool inverse = q->data.at(q->data.length()-1) == '-';
+        parseLeaf(q, label, inverse);
+        OperatorTimer timer(profiler.get(), profiledQuery, "project", pathstr, noEdges(graph, label, inverse));
+        result = timer.finish(SimpleEvaluator::project(label, inverse, graph, source, target, &threadPool));
+    }
 
-        result = SimpleEvaluator::project(label, inverse, graph);
+    if(q->isClosure()) {
+        // the closure applies the bound endpoints itself, its subquery is evaluated unbound
+        std::shared_ptr<intermediate> innerResult;
+        uint64_t input;
+        if (!q->left->isLeaf()) {
+            innerResult = SimpleEvaluator::evaluate_aux(q->left);
+            input = noPaths(innerResult);
+        } else {
+            parseLeaf(q->left, label, inverse);
+            input = noEdges(graph, label, inverse);
+        }
+        OperatorTimer timer(profiler.get(), profiledQuery, "closure", pathstr, input);
+        result = timer.finish(SimpleEvaluator::closure(q, innerResult, graph, source, target, &threadPool));
     }
 
     if(q->isConcat()) {
-        // evaluate the children
+        // evaluate the children; leaf children are read from the graph index directly
         std::shared_ptr<intermediate> leftResult, rightResult;
 
-        leftResult = SimpleEvaluator::evaluate_aux(q->left);
-        rightResult = SimpleEvaluator::evaluate_aux(q->right);
+        if (joinsRightLeaf(q, source, target)) {
+            leftResult = SimpleEvaluator::evaluate_aux(q->left, source, ANY_VERTEX);
+            parseLeaf(q->right, label, inverse);
+            OperatorTimer timer(profiler.get(), profiledQuery, "join", pathstr, noPaths(leftResult), noEdges(graph, label, inverse));
+            result = timer.finish(SimpleEvaluator::join(leftResult, label, inverse, graph, target, &threadPool));
+        } else if (q->left->isLeaf()) {
+            rightResult = SimpleEvaluator::evaluate_aux(q->right, ANY_VERTEX, target);
+            parseLeaf(q->left, label, inverse);
+            OperatorTimer timer(profiler.get(), profiledQuery, "join", pathstr, noEdges(graph, label, inverse), noPaths(rightResult));
+            result = timer.finish(SimpleEvaluator::join(label, inverse, rightResult, graph, source, &threadPool));
+        } else {
+            leftResult = SimpleEvaluator::evaluate_aux(q->left, source, ANY_VERTEX);
+            rightResult = SimpleEvaluator::evaluate_aux(q->right, ANY_VERTEX, target);
 
-        // join left with right
-        result = SimpleEvaluator::join(leftResult, rightResult);
+            // join left with right
+            OperatorTimer timer(profiler.get(), profiledQuery, "join", pathstr, noPaths(leftResult), noPaths(rightResult));
+            result = timer.finish(SimpleEvaluator::join(leftResult, rightResult, graph, &threadPool));
+        }
     }
 
-    evalCache[pathstr] = result;
+    evalCache.put(pathstr, result, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     return result;
 }
 
+#define ASYNC true
+
+cardStat SimpleEvaluator::evaluateStats(RPQTree *q, uint32_t source, uint32_t target) {
+#if ASYNC
+    auto stats = std::make_shared<std::promise<cardStat>>();
+    evaluateStats_async(q, source, target, [stats](cardStat result) { stats->set_value(result); },
+                        [stats](std::exception_ptr error) { stats->set_exception(error); });
+    return stats->get_future().get();
+#else
+    query_path path;
+    unpackQueryTree(&path, q);
+    const std::string pathstr = pathToString(&path, source, target);
+    auto cached = evalCache.get(pathstr);
+    if (cached != nullptr) {
+        cached = OperatorTimer(profiler.get(), profiledQuery, "cached", pathstr).finish(cached, false);
+        return computeStats(cached);
+    }
+
+    if (!q->isConcat()) {
+        auto result = evaluate_aux(q, source, target);
+        return computeStats(result);
+    }
+
+    // the top join only counts its output
+    uint32_t label;
+    bool inverse;
+    if (joinsRightLeaf(q, source, target)) {
+        auto left = evaluate_aux(q->left, source, ANY_VERTEX);
+        parseLeaf(q->right, label, inverse);
+        OperatorTimer timer(profiler.get(), profiledQuery, "count", pathstr, noPaths(left), noEdges(graph, label, inverse));
+        return timer.finish(SimpleEvaluator::joinStats(left, label, inverse, graph, target, &threadPool));
+    }
+    if (q->left->isLeaf()) {
+        auto right = evaluate_aux(q->right, ANY_VERTEX, target);
+        parseLeaf(q->left, label, inverse);
+        OperatorTimer timer(profiler.get(), profiledQuery, "count", pathstr, noEdges(graph, label, inverse), noPaths(right));
+        return timer.finish(SimpleEvaluator::joinStats(label, inverse, right, graph, source, &threadPool));
+    }
+    auto left = evaluate_aux(q->left, source, ANY_VERTEX);
+    auto right = evaluate_aux(q->right, ANY_VERTEX, target);
+    OperatorTimer timer(profiler.get(), profiledQuery, "count", pathstr, noPaths(left), noPaths(right));
+    return timer.finish(SimpleEvaluator::joinStats(left, right, graph, &threadPool));
+#endif
+}
+
 cardStat SimpleEvaluator::evaluate(RPQTree *query) {
-    std::vector<std::pair<uint32_t, bool>> path;
+    return evaluate(query, ANY_VERTEX, ANY_VERTEX);
+}
+
+cardStat SimpleEvaluator::evaluate(RPQTree *query, uint32_t source, uint32_t target) {
+    // a constant that is not a vertex of the graph matches nothing
+    if ((source != ANY_VERTEX && source >= graph->getNoVertices()) ||
+        (target != ANY_VERTEX && target >= graph->getNoVertices())) {
+        return {0, 0, 0};
+    }
+
+    query_path path;
     unpackQueryTree(&path, query);
 
-    const std::string pathstr = pathToString(&path);
+    const std::string pathstr = pathToString(&path, source, target);
     auto search = statCache.find(pathstr);
 
+    if (profiler != nullptr) {
+        profiledQuery = profiler->beginQuery(pathstr);
+    }
+
     if (search != statCache.end()) {
         // stat cache hit!
         std::cout << "\ncardStat cache hit! :D";
+        if (profiler != nullptr) profiler->endQuery(profiledQuery);
         return search->second;
     }
 
+    if (pathIndexBudget > 0) {
+        pathAdvisor.record(path);
+        ++recordedSinceBuild;
+        updatePathIndex();
+    }
+
     // stat cache miss
     std::cout << "\nOriginal query:\n";
     query->print();
 
     RPQTree *optimizedQuery = query;
 
-    if (est != nullptr) {
-        optimizedQuery = optimizeQuery(&path);
+    // the reduction only pays off when there are joins to prune, and not when the path itself is cached
+    bool reduce = semiJoinReduction && path.size() > 1 && !evalCache.contains(pathstr);
+    // the reduced graph has no path index, and every leaf of a reduced plan must be one step of the path; its
+    // relabelled leaves never meet the cache either, so cached subpaths are no cheaper there
+    if (est != nullptr || reduce || pathIndex != nullptr) {
+        optimizedQuery = optimizeQuery(&path, source, target, !reduce, !reduce);
     }
 
     std::cout << "\nOptimized query:\n";
     optimizedQuery->print();
 
-#define ASYNC true
-#if ASYNC
-    auto future = evaluate_async(optimizedQuery);
-    auto result = future.get();
-#else
-    auto result = evaluate_aux(optimizedQuery);
-#endif
-
-    auto stats = computeStats(result);
+    cardStat stats {0, 0, 0};
+    try {
+        if (reduce) {
+            // the plan is the one of the original path, with its label steps read from the reduced graph
+            auto reduced = SemiJoinReducer::reduce(*graph, path, source, target);
+            if (!reduced.empty) {
+                size_t step = 0;
+                relabelPlan(optimizedQuery, reduced.stepLabels, step);
+                for (size_t k = 0; k < path.size() && profiler != nullptr; ++k) {
+                    if (!path[k].isClosure()) reducedSteps.emplace(reduced.stepLabels[k], path[k]);
+                }
+                auto result = std::make_shared<std::promise<cardStat>>();
+                evaluateStats_async(optimizedQuery, source, target, [result](cardStat s) { result->set_value(s); },
+                                    [result](std::exception_ptr error) { result->set_exception(error); }, reduced.graph);
+                reducedSteps.clear();
+                stats = result->get_future().get();
+            }
+        } else {
+            stats = evaluateStats(optimizedQuery, source, target);
+        }
+    } catch (...) {
+        // the executor only fails once nothing runs on the plan any more
+        if (profiler != nullptr) profiler->endQuery(profiledQuery);
+        if (optimizedQuery != query) delete optimizedQuery;
+        throw;
+    }
     statCache[pathstr] = stats;
+    if (profiler != nullptr) profiler->endQuery(profiledQuery);
+
+    if (optimizedQuery != query) {
+        delete optimizedQuery;
+    }
 
     return stats;
 }
 
+std::vector<cardStat> SimpleEvaluator::evaluateBatch(std::vector<batchQuery> &queries) {
+
+    std::vector<cardStat> stats(queries.size(), {0, 0, 0});
+
+    // equivalent groupings of a path flatten to the same query path and are evaluated once
+    struct UniqueQuery {
+        query_path path;
+        uint32_t source, target;
+        std::string key;
+        std::vector<size_t> positions;
+    };
+    std::vector<UniqueQuery> unique;
+    std::unordered_map<std::string, size_t> uniqueByKey;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto &q = queries[i];
+        if ((q.source != ANY_VERTEX && q.source >= graph->getNoVertices()) ||
+            (q.target != ANY_VERTEX && q.target >= graph->getNoVertices())) {
+            continue;
+        }
+        query_path path;
+        unpackQueryTree(&path, q.query);
+        std::string key = pathToString(&path, q.source, q.target);
+
+        auto search = statCache.find(key);
+        if (search != statCache.end()) {
+            stats[i] = search->second;
+            continue;
+        }
+        auto inserted = uniqueByKey.emplace(key, unique.size());
+        if (inserted.second) {
+            unique.push_back({path, q.source, q.target, key, {}});
+        }
+        unique[inserted.first->second].positions.push_back(i);
+    }
+
+    // every subpath (of two or more steps, or a single closure) with the endpoints it is evaluated with
+    struct Subpath {
+        query_path path;
+        uint32_t source, target;
+        std::string key;
+        // (unique query, first step, last step) of every occurrence
+        std::vector<std::tuple<size_t, size_t, size_t>> occurrences;
+    };
+    std::unordered_map<std::string, Subpath> subpaths;
+    for (size_t u = 0; u < unique.size(); ++u) {
+        const auto &path = unique[u].path;
+        const size_t n = path.size();
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = path[i].isClosure() ? i : i + 1; j < n; ++j) {
+                query_path subpath(path.begin() + i, path.begin() + j + 1);
+                uint32_t source = i == 0 ? unique[u].source : ANY_VERTEX;
+                uint32_t target = j == n - 1 ? unique[u].target : ANY_VERTEX;
+                std::string key = pathToString(&subpath, source, target);
+                auto &entry = subpaths[key];
+                if (entry.occurrences.empty()) {
+                    entry = {subpath, source, target, key, {}};
+                }
+                entry.occurrences.emplace_back(u, i, j);
+            }
+        }
+    }
+
+    // share the subpaths that occur more than once, longest first; within a query the shared ranges must
+    // nest (or be disjoint) to fit in one plan tree
+    std::vector<Subpath *> candidates;
+    for (auto &keySubpathPair : subpaths) {
+        if (keySubpathPair.second.occurrences.size() > 1) candidates.push_back(&keySubpathPair.second);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Subpath *a, const Subpath *b) {
+        if (a->path.size() != b->path.size()) return a->path.size() > b->path.size();
+        if (a->occurrences.size() != b->occurrences.size()) return a->occurrences.size() > b->occurrences.size();
+        return a->key < b->key;
+    });
+
+    std::vector<std::vector<std::pair<size_t, size_t>>> sharedRanges(unique.size());
+    auto crosses = [](const std::pair<size_t, size_t> &a, const std::pair<size_t, size_t> &b) {
+        return (a.first < b.first && b.first <= a.second && a.second < b.second) ||
+               (b.first < a.first && a.first <= b.second && b.second < a.second);
+    };
+    std::vector<Subpath *> shared;
+    for (auto *candidate : candidates) {
+        std::vector<std::pair<size_t, std::pair<size_t, size_t>>> added;
+        bool fits = true;
+        for (const auto &occurrence : candidate->occurrences) {
+            auto &ranges = sharedRanges[std::get<0>(occurrence)];
+            std::pair<size_t, size_t> range {std::get<1>(occurrence), std::get<2>(occurrence)};
+            for (const auto &other : ranges) {
+                if (crosses(range, other)) fits = false;
+            }
+            if (!fits) break;
+            ranges.push_back(range);
+            added.emplace_back(std::get<0>(occurrence), range);
+        }
+        if (!fits) {
+            for (const auto &queryRangePair : added) {
+                auto &ranges = sharedRanges[queryRangePair.first];
+                ranges.erase(std::find(ranges.begin(), ranges.end(), queryRangePair.second));
+            }
+            continue;
+        }
+        shared.push_back(candidate);
+    }
+
+    std::cout << "\nBatch of " << queries.size() << " queries: " << unique.size() << " distinct, "
+              << shared.size() << " shared subpaths" << std::endl;
+
+    // the whole workload is known up front, so the path index is built for it before any plan is made
+    if (pathIndexBudget > 0 && !unique.empty()) {
+        for (const auto &q : unique) {
+            pathAdvisor.record(q.path, q.positions.size());
+        }
+        rebuildPathIndex();
+    }
+
+    // the shared subpaths are computed once and pinned in the cache, shortest first, so that the plans of longer
+    // ones (and of the queries) see them as cached leaves; subpaths of the same length run concurrently. Pinned
+    // results count against the cache budget: once a result does not fit, no longer subpaths are shared, and the
+    // queries compute what is missing themselves
+    std::sort(shared.begin(), shared.end(), [](const Subpath *a, const Subpath *b) {
+        return a->path.size() < b->path.size();
+    });
+    std::atomic<size_t> noPinned { 0 };
+    std::atomic<bool> budgetUsed { false };
+    for (size_t first = 0; first < shared.size() && !budgetUsed; ) {
+        size_t last = first;
+        while (last < shared.size() && shared[last]->path.size() == shared[first]->path.size()) ++last;
+
+        std::vector<RPQTree *> plans;
+        std::vector<std::future<void>> done;
+        for (size_t k = first; k < last; ++k) {
+            auto *subpath = shared[k];
+            plans.push_back(optimizeQuery(&subpath->path, subpath->source, subpath->target));
+            auto computed = std::make_shared<std::promise<void>>();
+            done.push_back(computed->get_future());
+            auto key = subpath->key;
+            auto profiler = this->profiler;
+            if (profiler != nullptr) profiledQuery = profiler->beginQuery(key);
+            auto query = profiledQuery;
+            evaluate_async(plans.back(), subpath->source, subpath->target, [this, key, computed, profiler, query, &noPinned, &budgetUsed](std::shared_ptr<intermediate> result) {
+                if (evalCache.pin(key, std::move(result))) {
+                    ++noPinned;
+                } else {
+                    budgetUsed = true;
+                }
+                if (profiler != nullptr) profiler->endQuery(query);
+                computed->set_value();
+            }, [computed](std::exception_ptr error) { computed->set_exception(error); });
+        }
+        // the plans are only deleted once nothing runs on them any more, and the first failure ends the batch
+        for (auto &computed : done) computed.wait();
+        for (auto *plan : plans) delete plan;
+        try {
+            for (auto &computed : done) computed.get();
+        } catch (...) {
+            evalCache.unpinAll();
+            throw;
+        }
+        first = last;
+    }
+    if (budgetUsed) {
+        std::cout << "Cache budget used up: " << noPinned << " of " << shared.size() << " shared subpaths pinned" << std::endl;
+    }
+
+    // then all queries at once on top of the shared subpaths
+    std::vector<RPQTree *> plans;
+    std::vector<std::future<cardStat>> results;
+    for (auto &q : unique) {
+        plans.push_back(optimizeQuery(&q.path, q.source, q.target));
+        auto result = std::make_shared<std::promise<cardStat>>();
+        results.push_back(result->get_future());
+        auto profiler = this->profiler;
+        if (profiler != nullptr) profiledQuery = profiler->beginQuery(q.key);
+        auto query = profiledQuery;
+        evaluateStats_async(plans.back(), q.source, q.target, [result, profiler, query](cardStat s) {
+            if (profiler != nullptr) profiler->endQuery(query);
+            result->set_value(s);
+        }, [result](std::exception_ptr error) { result->set_exception(error); });
+    }
+    for (auto &result : results) result.wait();
+    for (auto *plan : plans) delete plan;
+
+    // unpinned either way, so that a failed batch leaves the cache as a single query would
+    try {
+        for (size_t u = 0; u < unique.size(); ++u) {
+            cardStat result = results[u].get();
+            statCache[unique[u].key] = result;
+            for (auto position : unique[u].positions) {
+                stats[position] = result;
+            }
+        }
+    } catch (...) {
+        evalCache.unpinAll();
+        throw;
+    }
+
+    evalCache.unpinAll();
+    return stats;
+}
+
+void SimpleEvaluator::relabelPlan(RPQTree *plan, const std::vector<uint32_t> &stepLabels, size_t &step) {
+    if (plan->isConcat()) {
+        relabelPlan(plan->left, stepLabels, step);
+        relabelPlan(plan->right, stepLabels, step);
+        return;
+    }
+    if (plan->isLeaf()) {
+        plan->data = std::to_string(stepLabels[step]) + "+";
+    }
+    ++step;
+}
+
+std::string SimpleEvaluator::profileKey(RPQTree *q, uint32_t source, uint32_t target, bool reduced) {
+    query_path path;
+    unpackQueryTree(&path, q);
+    for (auto &step : path) {
+        auto search = reduced && !step.isClosure() ? reducedSteps.find(step.label) : reducedSteps.end();
+        if (search != reducedSteps.end()) step = search->second;
+    }
+    return pathToString(&path, source, target);
+}
+
 std::string SimpleEvaluator::pathToString(query_path *path) {
     std::stringstream ss;
-    for(const auto &pair : *path) {
-        ss << pair.first;
-        ss << (pair.second ? '+' : '-');
+    for(const auto &step : *path) {
+        if (step.isClosure()) {
+            query_path inner;
+            unpackQueryTree(&inner, step.closure->left);
+            ss << '(' << pathToString(&inner) << ')' << step.closure->data;
+            continue;
+        }
+        // a label of the path index stands for its path, so results are cached under the same key either way
+        if (pathIndex != nullptr && step.label >= pathIndex->noBaseLabels &&
+            step.label - pathIndex->noBaseLabels < pathIndex->paths.size()) {
+            ss << pathIndex->paths[step.label - pathIndex->noBaseLabels];
+            continue;
+        }
+        ss << step.label;
+        ss << (step.forward ? '+' : '-');
     }
     return ss.str();
 }
 
-void SimpleEvaluator::unpackQueryTree(std::vector<std::pair<uint32_t, bool>> *path, RPQTree *q) {
+// cache key of a path with its (possibly bound) endpoints, e.g. "*,0+1-,42"
+std::string SimpleEvaluator::pathToString(query_path *path, uint32_t source, uint32_t target) {
+    std::stringstream ss;
+    if (source == ANY_VERTEX) { ss << '*'; } else { ss << source; }
+    ss << ',' << pathToString(path) << ',';
+    if (target == ANY_VERTEX) { ss << '*'; } else { ss << target; }
+    return ss.str();
+}
+
+void SimpleEvaluator::unpackQueryTree(query_path *path, RPQTree *q) {
     if (q->isConcat()) {
         unpackQueryTree(path, q->left);
         unpackQueryTree(path, q->right);
         return;
     }
 
+    // a closure is a single step, its subquery is optimized and evaluated on its own
+    if (q->isClosure()) {
+        path->emplace_back(q);
+        return;
+    }
+
     char* sign;
     const auto label = static_cast<uint32_t>(strtoll(q->data.c_str(), &sign, 10));
     path->emplace_back(label, *sign == '+');
 }
 
-RPQTree* SimpleEvaluator::optimizeQuery(std::vector<std::pair<uint32_t, bool>> *path) {
+RPQTree* SimpleEvaluator::optimizeQuery(query_path *path, uint32_t source, uint32_t target, bool usePathIndex,
+                                        bool useCache) {
 
-    if (path->size() == 1) {
-        auto data = std::to_string((*path)[0].first) + ((*path)[0].second ? "+" : "-");
-        return new RPQTree(data, nullptr, nullptr);
-    }
+    const size_t n = path->size();
 
-    std::vector<std::pair<uint32_t, bool>> leftPath, rightPath;
+    // card[i][j]: estimated size of the subpath i..j, keeping the source bound when it starts the path
+    // and the target bound when it ends the path. one sampled walk from every i estimates all its subpaths.
+    // without an estimator every subpath looks alike and only cached subpaths steer the plan
+    std::vector<std::vector<double>> card(n, std::vector<double>(n, 0));
+    for (size_t i = 0; i < n && est != nullptr; ++i) {
+        query_path suffix(path->begin() + i, path->end());
+        auto prefixes = est->estimatePrefixes(suffix, i == 0 ? source : ANY_VERTEX, i == 0 ? target : ANY_VERTEX);
+        for (size_t j = i; j < n; ++j) {
+            card[i][j] = prefixes[j - i].noPaths;
+        }
+    }
+    if (target != ANY_VERTEX && est != nullptr) {
+        auto suffixes = est->estimateSuffixes(*path, target);
+        for (size_t i = (source == ANY_VERTEX ? 0 : 1); i < n; ++i) {
+            card[i][n - 1] = suffixes[i].noPaths;
+        }
+    }
+    // the profiler compares the output of every operator with the estimate it was planned with
+    for (size_t i = 0; i < n && est != nullptr && profiler != nullptr; ++i) {
+        for (size_t j = i; j < n; ++j) {
+            query_path subpath(path->begin() + i, path->begin() + j + 1);
+            profiler->setEstimate(pathToString(&subpath, i == 0 ? source : ANY_VERTEX, j == n - 1 ? target : ANY_VERTEX),
+                                  card[i][j]);
+        }
+    }
 
-    uint32_t bestEstimation = UINT32_MAX;
-    uint32_t bestEstimationSplit = 0;
+    // a label step is read from the graph index and never materialized, a closure step is; so is a subpath
+    // materialized in the path index, read through its label
+    std::vector<std::vector<bool>> indexed(n, std::vector<bool>(n, false));
+    for (size_t i = 0; i < n && usePathIndex && pathIndex != nullptr; ++i) {
+        for (size_t j = i + 1; j < n && j - i < PathIndexAdvisor::MAX_PATH_LENGTH && !(*path)[j].isClosure(); ++j) {
+            if ((*path)[i].isClosure()) break;
+            query_path subpath(path->begin() + i, path->begin() + j + 1);
+            indexed[i][j] = pathIndex->find(pathToString(&subpath)) != NO_PATH_LABEL;
+        }
+    }
+    auto isIndexLeaf = [&](size_t i, size_t j) { return i == j ? !(*path)[i].isClosure() : indexed[i][j]; };
+
+    // subpaths whose result is already cached (with the endpoints they would be evaluated with) cost
+    // nothing to produce, whatever their plan, as the executor looks every subplan up before running it
+    std::vector<std::vector<bool>> cached(n, std::vector<bool>(n, false));
+    for (size_t i = 0; i < n && useCache; ++i) {
+        for (size_t j = i; j < n; ++j) {
+            query_path subpath(path->begin() + i, path->begin() + j + 1);
+            cached[i][j] = evalCache.contains(pathToString(&subpath, i == 0 ? source : ANY_VERTEX,
+                                                           j == n - 1 ? target : ANY_VERTEX));
+        }
+    }
 
-    for (uint32_t split = 0; split < path->size()-1; ++split) {
-        leftPath.clear();
-        rightPath.clear();
-        for (size_t i = 0; i < path->size(); ++i) {
-            if (i <= split) { leftPath.emplace_back((*path)[i]); }
-            else           { rightPath.emplace_back((*path)[i]); }
+    // dynamic programming over all contiguous subpaths, like matrix-chain ordering:
+    // cost[i][j] is the cheapest total of intermediate sizes and join work to produce subpath i..j
+    std::vector<std::vector<double>> cost(n, std::vector<double>(n, 0));
+    std::vector<std::vector<size_t>> splits(n, std::vector<size_t>(n, 0));
+    for (size_t i = 0; i < n; ++i) {
+        cost[i][i] = isIndexLeaf(i, i) || cached[i][i] ? 0 : card[i][i];
+    }
+    for (size_t length = 2; length <= n; ++length) {
+        for (size_t i = 0; i + length <= n; ++i) {
+            size_t j = i + length - 1;
+            // planFromSplits reads a split at j as the path index leaf of i..j
+            if (indexed[i][j]) {
+                cost[i][j] = 0;
+                splits[i][j] = j;
+                continue;
+            }
+            if (cached[i][j]) {
+                cost[i][j] = 0;
+                splits[i][j] = i;
+                continue;
+            }
+            cost[i][j] = std::numeric_limits<double>::max();
+
+            for (size_t k = i; k < j; ++k) {
+                bool leftLeaf = isIndexLeaf(i, k);
+                bool rightLeaf = isIndexLeaf(k + 1, j);
+
+                // a join reads both of its materialized inputs and writes its output;
+                // of two labels, the one carrying the bound endpoint is projected (see joinsRightLeaf)
+                double leftInput = leftLeaf ? 0 : card[i][k];
+                double rightInput = rightLeaf ? 0 : card[k + 1][j];
+                if (leftLeaf && rightLeaf) {
+                    bool sourceBound = i == 0 && source != ANY_VERTEX;
+                    bool targetBound = j == n - 1 && target != ANY_VERTEX;
+                    bool projectRight = !sourceBound && targetBound;
+                    if (projectRight) { rightInput = card[k + 1][j]; }
+                    else              { leftInput = card[i][k]; }
+                }
+
+                double current = cost[i][k] + cost[k + 1][j] + leftInput + rightInput + card[i][j];
+                if (current < cost[i][j]) {
+                    cost[i][j] = current;
+                    splits[i][j] = k;
+                }
+            }
         }
+    }
 
-        cardStat leftEst = est->estimate_aux(leftPath);
-        cardStat rightEst = est->estimate_aux(rightPath);
-        uint32_t currentEst = std::max(leftEst.noPaths, rightEst.noPaths);
+    return planFromSplits(path, splits, 0, n - 1);
+}
 
-        if (currentEst < bestEstimation) {
-            bestEstimation = currentEst;
-            bestEstimationSplit = split;
+RPQTree* SimpleEvaluator::planFromSplits(query_path *path, std::vector<std::vector<size_t>> &splits, size_t i, size_t j) {
+
+    if (i == j) {
+        const auto &step = (*path)[i];
+        if (step.isClosure()) {
+            // the subquery of a closure is planned without bound endpoints, the closure applies them
+            query_path inner;
+            unpackQueryTree(&inner, step.closure->left);
+            std::string data = step.closure->data;
+            return new RPQTree(data, optimizeQuery(&inner), nullptr);
         }
+        auto data = std::to_string(step.label) + (step.forward ? "+" : "-");
+        return new RPQTree(data, nullptr, nullptr);
     }
 
-    leftPath.clear();
-    rightPath.clear();
-    for (size_t i = 0; i < path->size(); ++i) {
-        if (i <= bestEstimationSplit) {
-            leftPath.emplace_back((*path)[i]);
-        } else {
-            rightPath.emplace_back((*path)[i]);
-        }
+    if (splits[i][j] == j) {
+        query_path subpath(path->begin() + i, path->begin() + j + 1);
+        auto data = std::to_string(pathIndex->find(pathToString(&subpath))) + "+";
+        return new RPQTree(data, nullptr, nullptr);
     }
 
-    RPQTree* leftTree = optimizeQuery(&leftPath);
-    RPQTree* rightTree = optimizeQuery(&rightPath);
+    RPQTree* leftTree = planFromSplits(path, splits, i, splits[i][j]);
+    RPQTree* rightTree = planFromSplits(path, splits, splits[i][j] + 1, j);
 
     std::string data = "/";
     return new RPQTree(data, leftTree, rightTree);
 }
 
-std::shared_future<std::shared_ptr<intermediate>> SimpleEvaluator::evaluate_async(RPQTree* q) {
+void SimpleEvaluator::evaluate_async(RPQTree* q, uint32_t source, uint32_t target, continuation done, failure fail,
+                                     std::shared_ptr<SimpleGraph> reduced) {
+
+    auto graph = reduced != nullptr ? reduced : this->graph;
+    auto pool = &threadPool;
+    auto profiler = this->profiler.get();
+    const uint32_t query = profiledQuery;
+    const std::string key = profiler != nullptr ? profileKey(q, source, target, reduced != nullptr) : std::string();
+
+    // a cached subpath is handed on as is; otherwise its result is cached once computed, costed by the
+    // time from scheduling to completion
+    if (reduced == nullptr) {
+        query_path path;
+        unpackQueryTree(&path, q);
+        std::string pathstr = pathToString(&path, source, target);
+        auto cached = evalCache.get(pathstr);
+        if (cached != nullptr) {
+            threadPool.submit([done, cached, profiler, query, key]() {
+                done(OperatorTimer(profiler, query, "cached", key).finish(cached, false));
+            }, fail);
+            return;
+        }
+        auto cache = &evalCache;
+        auto start = std::chrono::steady_clock::now();
+        done = [done, cache, pathstr, start](std::shared_ptr<intermediate> result) {
+            cache->put(pathstr, result, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            done(std::move(result));
+        };
+    }
 
     if (q->isLeaf()) {
-        return threadPool.enqueue([](RPQTree* q, std::shared_ptr<SimpleGraph> graph) {
-            uint32_t label = (uint32_t) std::stoul(q->data.substr(0, q->data.length()-1));
-            bool inverse = q->data.at(q->data.length()-1) == '-';
-            return SimpleEvaluator::project(label, inverse, graph);
-        }, q, graph);
+        threadPool.submit([q, graph, source, target, done, pool, profiler, query, key]() mutable {
+            uint32_t label;
+            bool inverse;
+            parseLeaf(q, label, inverse);
+            OperatorTimer timer(profiler, query, "project", key, noEdges(graph, label, inverse));
+            done(timer.finish(SimpleEvaluator::project(label, inverse, graph, source, target, pool)));
+        }, fail);
+        return;
     }
 
-    auto* leftFuture = new std::shared_future<std::shared_ptr<intermediate>>();
-    auto* rightFuture = new std::shared_future<std::shared_ptr<intermediate>>();
+    if (q->isClosure()) {
+        auto closure = [q, graph, source, target, done, pool, profiler, query, key](std::shared_ptr<intermediate> inner) mutable {
+            uint64_t input = noPaths(inner);
+            if (inner == nullptr) {
+                uint32_t label;
+                bool inverse;
+                parseLeaf(q->left, label, inverse);
+                input = noEdges(graph, label, inverse);
+            }
+            OperatorTimer timer(profiler, query, "closure", key, input);
+            done(timer.finish(SimpleEvaluator::closure(q, inner, graph, source, target, pool)));
+        };
+        if (q->left->isLeaf()) {
+            threadPool.submit([closure]() mutable { closure(nullptr); }, fail);
+        } else {
+            // the subquery's last operator continues with the closure itself
+            evaluate_async(q->left, ANY_VERTEX, ANY_VERTEX, closure, fail, reduced);
+        }
+        return;
+    }
 
-    // prioritize subtree evaluation over leaf evaluation
-    if (q->left->isLeaf() && !q->right->isLeaf()) {
-        *rightFuture = evaluate_async(q->right);
-        *leftFuture = evaluate_async(q->left);
-    } else {
-        *leftFuture = evaluate_async(q->left);
-        *rightFuture = evaluate_async(q->right);
+    // a leaf child is not projected, the join reads its neighbours from the graph index instead
+    if (q->right->isLeaf() || q->left->isLeaf()) {
+        bool leafRight = joinsRightLeaf(q, source, target);
+        RPQTree *leaf = leafRight ? q->right : q->left;
+        uint32_t bound = leafRight ? target : source;
+
+        // the leaf carries the endpoint on its side of the join
+        auto join = [leaf, leafRight, graph, bound, done, pool, profiler, query, key](std::shared_ptr<intermediate> subtree) mutable {
+            uint32_t label;
+            bool inverse;
+            parseLeaf(leaf, label, inverse);
+            if (leafRight) {
+                OperatorTimer timer(profiler, query, "join", key, noPaths(subtree), noEdges(graph, label, inverse));
+                done(timer.finish(SimpleEvaluator::join(subtree, label, inverse, graph, bound, pool)));
+            } else {
+                OperatorTimer timer(profiler, query, "join", key, noEdges(graph, label, inverse), noPaths(subtree));
+                done(timer.finish(SimpleEvaluator::join(label, inverse, subtree, graph, bound, pool)));
+            }
+        };
+        if (leafRight) {
+            evaluate_async(q->left, source, ANY_VERTEX, join, fail, reduced);
+        } else {
+            evaluate_async(q->right, ANY_VERTEX, target, join, fail, reduced);
+        }
+        return;
     }
 
-    // <-- both left and right are NOW queued, so will finish before the next join job we enqueue here
-    return threadPool.enqueue([](std::shared_future<std::shared_ptr<intermediate>>* leftFuture,
-                                 std::shared_future<std::shared_ptr<intermediate>>* rightFuture){
+    evaluateBoth_async(q->left, source, q->right, target,
+                       [graph, done, pool, profiler, query, key](std::shared_ptr<intermediate> left, std::shared_ptr<intermediate> right) mutable {
+        OperatorTimer timer(profiler, query, "join", key, noPaths(left), noPaths(right));
+        done(timer.finish(SimpleEvaluator::join(left, right, graph, pool)));
+    }, fail, reduced);
+}
+
+void SimpleEvaluator::evaluateBoth_async(RPQTree *left, uint32_t source, RPQTree *right, uint32_t target,
+                                         std::function<void(std::shared_ptr<intermediate>, std::shared_ptr<intermediate>)> done,
+                                         failure fail, std::shared_ptr<SimpleGraph> reduced) {
+
+    // both subtrees run independently; whichever finishes last schedules the continuation. A failure is only
+    // passed on once the other subtree is done as well, so that nothing runs on the plan any more by then
+    struct Inputs {
         std::shared_ptr<intermediate> left, right;
+        std::atomic<int> pending {2};
+        std::mutex mutex;
+        std::exception_ptr error;
+    };
+    auto inputs = std::make_shared<Inputs>();
+    auto pool = &threadPool;
+    auto arrive = [inputs, done, fail, pool]() {
+        if (--inputs->pending > 0) return;
+        if (inputs->error != nullptr) {
+            fail(inputs->error);
+            return;
+        }
+        pool->submit([inputs, done]() {
+            done(inputs->left, inputs->right);
+        }, fail);
+    };
+    auto failOnce = [inputs, arrive](std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(inputs->mutex);
+            if (inputs->error == nullptr) inputs->error = error;
+        }
+        arrive();
+    };
+
+    evaluate_async(left, source, ANY_VERTEX, [inputs, arrive](std::shared_ptr<intermediate> result) {
+        inputs->left = std::move(result);
+        arrive();
+    }, failOnce, reduced);
+    evaluate_async(right, ANY_VERTEX, target, [inputs, arrive](std::shared_ptr<intermediate> result) {
+        inputs->right = std::move(result);
+        arrive();
+    }, failOnce, reduced);
+}
+
+void SimpleEvaluator::evaluateStats_async(RPQTree *q, uint32_t source, uint32_t target, std::function<void(cardStat)> done,
+                                          failure fail, std::shared_ptr<SimpleGraph> reduced) {
+
+    auto graph = reduced != nullptr ? reduced : this->graph;
+    auto pool = &threadPool;
+    auto profiler = this->profiler.get();
+    const uint32_t query = profiledQuery;
+    const std::string key = profiler != nullptr && q->isConcat() ? profileKey(q, source, target, reduced != nullptr) : std::string();
+
+    // the whole path may be cached already, e.g. as part of an earlier query
+    if (reduced == nullptr) {
+        query_path path;
+        unpackQueryTree(&path, q);
+        std::string pathstr = pathToString(&path, source, target);
+        auto cached = evalCache.get(pathstr);
+        if (cached != nullptr) {
+            threadPool.submit([this, cached, done, profiler, query, pathstr]() mutable {
+                OperatorTimer(profiler, query, "cached", pathstr).finish(cached, false);
+                done(computeStats(cached));
+            }, fail);
+            return;
+        }
+    }
+
+    if (!q->isConcat()) {
+        evaluate_async(q, source, target, [this, done](std::shared_ptr<intermediate> result) {
+            done(computeStats(result));
+        }, fail, reduced);
+        return;
+    }
 
-        // when this job is being executed, left and right have already started, we only need to wait :)
-        left = leftFuture->get();
-        right = rightFuture->get();
-        delete leftFuture, rightFuture;
-        return SimpleEvaluator::join(left, right);
-    }, leftFuture, rightFuture);
+    // the top join only counts its output
+    uint32_t label;
+    bool inverse;
+    if (joinsRightLeaf(q, source, target)) {
+        parseLeaf(q->right, label, inverse);
+        evaluate_async(q->left, source, ANY_VERTEX,
+                       [graph, label, inverse, target, pool, done, profiler, query, key](std::shared_ptr<intermediate> left) mutable {
+            OperatorTimer timer(profiler, query, "count", key, noPaths(left), noEdges(graph, label, inverse));
+            done(timer.finish(SimpleEvaluator::joinStats(left, label, inverse, graph, target, pool)));
+        }, fail, reduced);
+        return;
+    }
+    if (q->left->isLeaf()) {
+        parseLeaf(q->left, label, inverse);
+        evaluate_async(q->right, ANY_VERTEX, target,
+                       [graph, label, inverse, source, pool, done, profiler, query, key](std::shared_ptr<intermediate> right) mutable {
+            OperatorTimer timer(profiler, query, "count", key, noEdges(graph, label, inverse), noPaths(right));
+            done(timer.finish(SimpleEvaluator::joinStats(label, inverse, right, graph, source, pool)));
+        }, fail, reduced);
+        return;
+    }
+    evaluateBoth_async(q->left, source, q->right, target,
+                       [graph, pool, done, profiler, query, key](std::shared_ptr<intermediate> left, std::shared_ptr<intermediate> right) mutable {
+        OperatorTimer timer(profiler, query, "count", key, noPaths(left), noPaths(right));
+        done(timer.finish(SimpleEvaluator::joinStats(left, right, graph, pool)));
+    }, fail, reduced);
 }
@@ -4,7 +4,12 @@
 
 #include "SimpleGraph.h"
 
-SimpleGraph::SimpleGraph(uint32_t n)   {
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+SimpleGraph::SimpleGraph(uint32_t n) : L(0), E(0), packIndexes(false) {
     setNoVertices(n);
 }
 
@@ -17,11 +22,7 @@ void SimpleGraph::setNoVertices(uint32_t n) {
 }
 
 uint32_t SimpleGraph::getNoEdges() const {
-    uint32_t sum = 0;
-    for (const auto &edgeList : edgeLists) {
-        sum += edgeList.size();
-    }
-    return sum;
+    return static_cast<uint32_t>(E);
 }
 
 // sort on the second item in the pair, then on the first (ascending order)
@@ -34,6 +35,14 @@ bool sortPairs(const std::pair<uint32_t,uint32_t> &a, const std::pair<uint32_t,u
 uint32_t SimpleGraph::getNoDistinctEdges() const {
     uint32_t sum = 0;
 
+    // the indexes are deduplicated already
+    if (forwardIndex.size() == L) {
+        for (const auto &index : forwardIndex) {
+            sum += index.noTargets;
+        }
+        return sum;
+    }
+
     for (auto edgeList : edgeLists) {
         std::sort(edgeList.begin(), edgeList.end(), sortPairs);
 
@@ -73,37 +82,82 @@ void SimpleGraph::addEdge(uint32_t from, uint32_t to, uint32_t edgeLabel) {
                                          std::to_string(edgeLabel) + ")");
 
     edgeLists[edgeLabel].emplace_back(std::make_pair(from, to));
+    E++;
 }
 
-bool SimpleGraph::getValuesFromLine(std::string &line, char sep, uint32_t (&values)[3]) {
-    size_t ppos = 0;
-    size_t pos;
+bool SimpleGraph::getValuesFromLine(const char *pos, const char *end, char sep, uint32_t (&values)[3]) {
+    // scans the first three unsigned integers in place; trailing fields (" .", "\r") are ignored
+    for (int i = 0; i < 3; ++i) {
+        while (pos < end && (*pos == ' ' || *pos == '\t')) ++pos;
+        if (pos == end || *pos < '0' || *pos > '9') {
+            return false;
+        }
 
-    if (*line.rbegin() == '\r') { // windows.. smh
-        line.erase(0, line.length() - 1);
-    }
+        uint64_t value = 0;
+        for (; pos < end && *pos >= '0' && *pos <= '9'; ++pos) {
+            value = value * 10 + (*pos - '0');
+            if (value > UINT32_MAX) {
+                return false;
+            }
+        }
+        values[i] = static_cast<uint32_t>(value);
 
-    for (int i = 0; i < 3; ++i) {
-        pos = line.find(sep, ppos);
-        if (pos == std::string::npos) {
-            values[i] = static_cast<uint32_t>(std::stoul(line.substr(ppos)));
-            return i == 2;
+        if (i < 2) {
+            if (sep != ' ') {
+                while (pos < end && (*pos == ' ' || *pos == '\t')) ++pos;
+            }
+            if (pos == end || (*pos != sep && !(sep == ' ' && *pos == '\t'))) {
+                return false;
+            }
+            ++pos;
         }
-        values[i] = static_cast<uint32_t>(std::stoul(line.substr(ppos, pos-ppos)));
-        ppos = pos + 1;
     }
     return true;
 }
 
+// edges parsed from one newline-aligned chunk of the graph file, [label] -> [(source, destination), ...]
+struct EdgeChunk {
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> edgeLists;
+    uint64_t noEdges = 0;
+    std::string error;
+};
+
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+static unsigned int noLoaderThreads(size_t work, size_t minWork) {
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned int>(std::max<size_t>(1, std::min(threads, work / minWork)));
+}
+
+// labels are independent, they are indexed in parallel
+static void forEachLabel(uint32_t noLabels, uint64_t noEdges, const std::function<void(uint32_t)> &body) {
+    std::atomic<uint32_t> nextLabel { 0 };
+    auto buildLabels = [&]() {
+        for (uint32_t label = nextLabel++; label < noLabels; label = nextLabel++) {
+            body(label);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < std::min<size_t>(noLoaderThreads(noEdges, MIN_CHUNK_SIZE / 8), noLabels); ++i) {
+        workers.emplace_back(buildLabels);
+    }
+    buildLabels();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
 void SimpleGraph::readFromContiguousFile(const std::string &fileName) {
-    std::string line;
-    std::ifstream graphFile { fileName };
+    MappedFile graphFile { fileName };
+    const char *pos = graphFile.data();
+    const char *end = pos + graphFile.size();
 
     // parse the header (1st line)
     // header format: "noNodes,noEdges,noLabels\n"
-    std::getline(graphFile, line);
+    const char *headerEnd = std::find(pos, end, '\n');
     uint32_t values[3];
-    if (!getValuesFromLine(line, ',', values)) {
+    if (!getValuesFromLine(pos, headerEnd, ',', values)) {
         throw std::runtime_error(std::string("Invalid graph header!"));
     }
     uint32_t noNodes = values[0];
@@ -111,15 +165,632 @@ void SimpleGraph::readFromContiguousFile(const std::string &fileName) {
 
     setNoVertices(noNodes);
     setNoLabels(noLabels);
+    internalIds.clear();
+    externalIds.clear();
 
     // parse edge data
     // edge data format: "source label destination .\n"
-    while(std::getline(graphFile, line)) {
-        if (getValuesFromLine(line, ' ', values)) {
-            addEdge(values[0], values[2], values[1]);
+    // the body is split in newline-aligned chunks that are parsed in parallel
+    const char *body = std::min(headerEnd + 1, end);
+    const unsigned int noChunks = noLoaderThreads(static_cast<size_t>(end - body), MIN_CHUNK_SIZE);
+    std::vector<const char *> bounds { body };
+    for (unsigned int i = 1; i < noChunks; ++i) {
+        const char *bound = std::max(bounds.back(), body + (end - body) * i / noChunks);
+        bound = std::find(bound, end, '\n');
+        bounds.push_back(bound == end ? end : bound + 1);
+    }
+    bounds.push_back(end);
+
+    std::vector<EdgeChunk> chunks(noChunks);
+    auto parseChunk = [&](unsigned int chunkId) {
+        EdgeChunk &chunk = chunks[chunkId];
+        chunk.edgeLists.resize(noLabels);
+        uint32_t values[3];
+        for (const char *line = bounds[chunkId], *chunkEnd = bounds[chunkId + 1]; line < chunkEnd; ) {
+            const char *lineEnd = std::find(line, chunkEnd, '\n');
+            if (getValuesFromLine(line, lineEnd, ' ', values)) {
+                // values = (source, label, destination)
+                if (values[0] >= noNodes || values[2] >= noNodes || values[1] >= noLabels) {
+                    chunk.error = std::string("Edge data out of bounds: ") +
+                                  "(" + std::to_string(values[0]) + "," + std::to_string(values[2]) + "," +
+                                  std::to_string(values[1]) + ")";
+                    return;
+                }
+                chunk.edgeLists[values[1]].emplace_back(values[0], values[2]);
+                chunk.noEdges++;
+            }
+            line = lineEnd + 1;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < noChunks; ++i) {
+        workers.emplace_back(parseChunk, i);
+    }
+    parseChunk(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // merge the chunks in file order
+    for (const auto &chunk : chunks) {
+        if (!chunk.error.empty()) {
+            throw std::runtime_error(chunk.error);
+        }
+    }
+    for (uint32_t label = 0; label < noLabels; ++label) {
+        auto &edgeList = edgeLists[label];
+        size_t size = edgeList.size();
+        for (const auto &chunk : chunks) {
+            size += chunk.edgeLists[label].size();
+        }
+        edgeList.reserve(size);
+        for (auto &chunk : chunks) {
+            edgeList.insert(edgeList.end(), chunk.edgeLists[label].begin(), chunk.edgeLists[label].end());
+            std::vector<std::pair<uint32_t, uint32_t>>().swap(chunk.edgeLists[label]);
+        }
+    }
+    for (const auto &chunk : chunks) {
+        E += chunk.noEdges;
+    }
+
+    buildIndexes();
+}
+
+// counting sort the edges on their origin into the CSR arrays, then sort and deduplicate every neighbour range
+void SimpleGraph::buildAdjacency(const std::vector<std::pair<uint32_t, uint32_t>> &edges, bool reverse,
+                                 uint32_t noVertices, AdjacencyIndex &index) {
+    auto &offsets = index.offsetStorage;
+    auto &targets = index.targetStorage;
+
+    offsets.assign(noVertices + 1, 0);
+    for (const auto &edge : edges) {
+        offsets[(reverse ? edge.second : edge.first) + 1]++;
+    }
+    for (uint32_t v = 0; v < noVertices; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    targets.resize(edges.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (const auto &edge : edges) {
+        if (reverse) { targets[fill[edge.second]++] = edge.first; }
+        else         { targets[fill[edge.first]++] = edge.second; }
+    }
+
+    // compact the ranges in place; offsets[v+1] is read before it gets overwritten
+    uint32_t write = 0;
+    uint32_t rangeBegin = 0;
+    for (uint32_t v = 0; v < noVertices; ++v) {
+        uint32_t rangeEnd = offsets[v + 1];
+        std::sort(targets.begin() + rangeBegin, targets.begin() + rangeEnd);
+        offsets[v] = write;
+        for (uint32_t i = rangeBegin; i < rangeEnd; ++i) {
+            if (i == rangeBegin || targets[i] != targets[i - 1]) {
+                targets[write++] = targets[i];
+            }
+        }
+        rangeBegin = rangeEnd;
+    }
+    offsets[noVertices] = write;
+    targets.resize(write);
+    targets.shrink_to_fit();
+
+    index.offsets = offsets.data();
+    index.targets = targets.data();
+    index.noTargets = write;
+}
+
+// replaces a plain index by its packed form
+static void packIndex(AdjacencyIndex &index, uint32_t noVertices) {
+    if (index.isPacked()) return;
+    index.packed = PackedLists::pack(index.offsets, index.targets, noVertices);
+    index.offsets = nullptr;
+    index.targets = nullptr;
+    std::vector<uint32_t>().swap(index.offsetStorage);
+    std::vector<uint32_t>().swap(index.targetStorage);
+}
+
+void SimpleGraph::buildIndexes() {
+    snapshot.reset();
+    forwardIndex.clear();
+    reverseIndex.clear();
+    forwardIndex.resize(L);
+    reverseIndex.resize(L);
+
+    // a packed label is the only copy of its edges, so its edge list goes right away
+    forEachLabel(L, E, [this](uint32_t label) {
+        buildAdjacency(edgeLists[label], false, V, forwardIndex[label]);
+        buildAdjacency(edgeLists[label], true, V, reverseIndex[label]);
+        if (packIndexes) {
+            packIndex(forwardIndex[label], V);
+            packIndex(reverseIndex[label], V);
+            std::vector<std::pair<uint32_t, uint32_t>>().swap(edgeLists[label]);
+        }
+    });
+}
+
+// new id -> old id of every vertex
+std::vector<uint32_t> SimpleGraph::vertexOrder(VertexOrder order) const {
+    std::vector<uint32_t> vertices(V);
+    for (uint32_t v = 0; v < V; ++v) vertices[v] = v;
+    if (order == VertexOrder::input) return vertices;
+
+    // one reader per label and direction, forward ones first
+    std::vector<NeighbourReader> readers;
+    for (const auto *indexes : {&forwardIndex, &reverseIndex}) {
+        for (const auto &index : *indexes) readers.emplace_back(index);
+    }
+
+    // in and out degree over all labels
+    std::vector<uint32_t> degree(V, 0);
+    for (auto &reader : readers) {
+        for (uint32_t v = 0; v < V; ++v) {
+            degree[v] += reader.degree(v);
+        }
+    }
+    auto higherDegree = [&](uint32_t a, uint32_t b) { return degree[a] > degree[b] || (degree[a] == degree[b] && a < b); };
+    auto lowerDegree = [&](uint32_t a, uint32_t b) { return degree[a] < degree[b] || (degree[a] == degree[b] && a < b); };
+
+    if (order == VertexOrder::degree) {
+        std::sort(vertices.begin(), vertices.end(), higherDegree);
+        return vertices;
+    }
+
+    // breadth-first over the edges in both directions; Cuthill-McKee starts every component at a vertex of
+    // low degree and visits neighbours by increasing degree, and is then reversed
+    const bool rcm = order == VertexOrder::rcm;
+    std::vector<uint32_t> starts(vertices);
+    if (rcm) { std::sort(starts.begin(), starts.end(), lowerDegree); }
+    else     { std::sort(starts.begin(), starts.end(), higherDegree); }
+    std::vector<bool> visited(V, false);
+    std::vector<uint32_t> neighbours;
+    vertices.clear();
+    for (auto start : starts) {
+        if (visited[start]) continue;
+        visited[start] = true;
+        size_t tail = vertices.size();
+        vertices.push_back(start);
+        for (; tail < vertices.size(); ++tail) {
+            const uint32_t v = vertices[tail];
+            neighbours.clear();
+            for (auto &reader : readers) {
+                for (auto n : reader(v)) {
+                    if (!visited[n]) {
+                        visited[n] = true;
+                        neighbours.push_back(n);
+                    }
+                }
+            }
+            if (rcm) std::sort(neighbours.begin(), neighbours.end(), lowerDegree);
+            vertices.insert(vertices.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+    if (rcm) std::reverse(vertices.begin(), vertices.end());
+    return vertices;
+}
+
+void SimpleGraph::reorderVertices(VertexOrder order) {
+    if (order == VertexOrder::input) return;
+
+    auto newToOld = vertexOrder(order);
+    std::vector<uint32_t> oldToNew(V);
+    for (uint32_t v = 0; v < V; ++v) oldToNew[newToOld[v]] = v;
+
+    // the indexes are rebuilt from the current ones, which also covers a graph read from a snapshot
+    const bool compressed = packIndexes || isCompressed();
+    std::vector<AdjacencyIndex> forward(L), reverse(L);
+    forEachLabel(L, E, [&](uint32_t label) {
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        edges.reserve(forwardIndex[label].noTargets);
+        NeighbourReader neighbours(forwardIndex[label]);
+        for (uint32_t v = 0; v < V; ++v) {
+            for (auto n : neighbours(v)) {
+                edges.emplace_back(oldToNew[v], oldToNew[n]);
+            }
+        }
+        buildAdjacency(edges, false, V, forward[label]);
+        buildAdjacency(edges, true, V, reverse[label]);
+        if (compressed) {
+            packIndex(forward[label], V);
+            packIndex(reverse[label], V);
+        }
+    });
+    forwardIndex = std::move(forward);
+    reverseIndex = std::move(reverse);
+    snapshot.reset();
+
+    for (auto &edgeList : edgeLists) {
+        for (auto &edge : edgeList) {
+            edge = {oldToNew[edge.first], oldToNew[edge.second]};
+        }
+    }
+
+    // compose with an earlier reordering, so the ids still map back to the input's
+    if (!externalIds.empty()) {
+        for (auto &v : newToOld) v = externalIds[v];
+        for (uint32_t v = 0; v < V; ++v) oldToNew[newToOld[v]] = v;
+    }
+    externalIds = std::move(newToOld);
+    internalIds = std::move(oldToNew);
+}
+
+void SimpleGraph::compressIndexes() {
+    if (forwardIndex.size() != L || reverseIndex.size() != L) {
+        throw std::runtime_error(std::string("Cannot compress, graph indexes are not built"));
+    }
+
+    // lists packed already may lie in a mapped snapshot, which then has to stay
+    const bool mapped = isCompressed();
+    forEachLabel(L, E, [this](uint32_t label) {
+        packIndex(forwardIndex[label], V);
+        packIndex(reverseIndex[label], V);
+    });
+
+    // the packed indexes are the only copy of the edges from here on, and so are those rebuilt later
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>>().swap(edgeLists);
+    if (!mapped) snapshot.reset();
+    packIndexes = true;
+}
+
+void SimpleGraph::compressOnBuild() {
+    packIndexes = true;
+}
+
+bool SimpleGraph::isCompressed() const {
+    return !forwardIndex.empty() && forwardIndex[0].isPacked();
+}
+
+size_t SimpleGraph::memoryUsage() const {
+    size_t bytes = 0;
+    for (const auto *indexes : {&forwardIndex, &reverseIndex}) {
+        for (const auto &index : *indexes) {
+            // plain indexes count their offsets and targets, whether on the heap or in a mapped snapshot
+            if (index.isPacked()) bytes += index.packed->memoryUsage();
+            else if (index.offsets != nullptr) bytes += (size_t(V) + 1 + index.noTargets) * sizeof(uint32_t);
+        }
+    }
+    for (const auto &edgeList : edgeLists) {
+        bytes += edgeList.capacity() * sizeof(std::pair<uint32_t, uint32_t>);
+    }
+    return bytes;
+}
+
+std::shared_ptr<SimpleGraph> SimpleGraph::extend(const SimpleGraph &base, uint32_t noExtraLabels) {
+    auto extended = std::make_shared<SimpleGraph>(base.V);
+    extended->setNoLabels(base.L + noExtraLabels);
+    extended->forwardIndex.resize(extended->L);
+    extended->reverseIndex.resize(extended->L);
+    for (uint32_t label = 0; label < base.L; ++label) {
+        for (bool inverse : {false, true}) {
+            const auto &original = base.getIndex(label, inverse);
+            auto &view = inverse ? extended->reverseIndex[label] : extended->forwardIndex[label];
+            view.view(original);
         }
     }
+    return extended;
+}
+
+NeighbourRange NeighbourReader::filter(uint32_t v) {
+    const auto &sources = *index->sourceFilter;
+    const auto &targets = *index->targetFilter;
+    if (!((sources[v / 64] >> (v % 64)) & 1)) return {nullptr, nullptr};
+    filtered.clear();
+    for (auto w : list(v)) {
+        if ((targets[w / 64] >> (w % 64)) & 1) filtered.push_back(w);
+    }
+    return {filtered.data(), filtered.data() + filtered.size()};
+}
+
+const AdjacencyIndex &SimpleGraph::getIndex(uint32_t label, bool inverse) const {
+    return inverse ? reverseIndex[label] : forwardIndex[label];
+}
+
+// snapshot layout, native byte order; every section starts at a multiple of SNAPSHOT_ALIGNMENT. Version 2 added
+// the flags, version 1 files are read as plain snapshots
+static const char SNAPSHOT_MAGIC[8] = {'Q', 'S', 'G', 'R', 'A', 'P', 'H', '\0'};
+static const uint32_t SNAPSHOT_VERSION = 2;
+static const uint64_t SNAPSHOT_ALIGNMENT = 64;
+// the label directory holds SnapshotPackedEntry instead of SnapshotLabelEntry
+static const uint32_t SNAPSHOT_PACKED = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t noVertices;
+    uint32_t noLabels;
+    uint32_t flags;
+    uint64_t noEdges;
+};
+
+// one entry per label, positions are byte offsets from the start of the file
+struct SnapshotLabelEntry {
+    uint64_t forwardOffsets;
+    uint64_t forwardTargets;
+    uint64_t reverseOffsets;
+    uint64_t reverseTargets;
+    uint32_t forwardNoTargets;
+    uint32_t reverseNoTargets;
+};
+
+// the arrays of one PackedLists; their lengths follow from the counts and the number of vertices
+struct SnapshotPackedLists {
+    uint64_t words;
+    uint64_t groupPositions;
+    uint64_t offsetBlocks;
+    uint64_t offsetWidths;
+    uint64_t valueBlocks;
+    uint64_t valueWidths;
+    uint32_t noValues;
+    uint32_t noWords;
+};
+
+struct SnapshotPackedEntry {
+    SnapshotPackedLists forward;
+    SnapshotPackedLists reverse;
+};
+
+static uint64_t alignSection(uint64_t position) {
+    return (position + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+// places the arrays of lists behind position
+static SnapshotPackedLists layoutPacked(const PackedLists &lists, uint64_t &position) {
+    const uint64_t groups = lists.noGroups(), blocks = lists.noValueBlocks();
+    SnapshotPackedLists entry {};
+    entry.noValues = lists.noValues;
+    entry.noWords = lists.noWords;
+    entry.words = position = alignSection(position);
+    position += uint64_t(lists.noWords) * sizeof(uint32_t);
+    entry.groupPositions = position = alignSection(position);
+    position += (groups + 1) * sizeof(uint32_t);
+    entry.offsetBlocks = position = alignSection(position);
+    position += groups * sizeof(uint32_t);
+    entry.offsetWidths = position = alignSection(position);
+    position += groups;
+    entry.valueBlocks = position = alignSection(position);
+    position += blocks * sizeof(uint32_t);
+    entry.valueWidths = position = alignSection(position);
+    position += blocks;
+    return entry;
+}
+
+void SimpleGraph::writeSnapshot(const std::string &fileName) const {
+    if (forwardIndex.size() != L || reverseIndex.size() != L) {
+        throw std::runtime_error(std::string("Cannot write snapshot, graph indexes are not built"));
+    }
+    const bool packed = isCompressed();
+    for (const auto *indexes : {&forwardIndex, &reverseIndex}) {
+        for (const auto &index : *indexes) {
+            if (index.isPacked() != packed) {
+                throw std::runtime_error(std::string("Cannot write snapshot, graph indexes are partly compressed"));
+            }
+        }
+    }
+
+    SnapshotHeader header {};
+    std::copy(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 8, header.magic);
+    header.version = SNAPSHOT_VERSION;
+    header.noVertices = V;
+    header.noLabels = L;
+    header.flags = packed ? SNAPSHOT_PACKED : 0;
+    header.noEdges = E;
+
+    // lay out the sections behind the header and label directory
+    std::vector<SnapshotLabelEntry> directory(packed ? 0 : L);
+    std::vector<SnapshotPackedEntry> packedDirectory(packed ? L : 0);
+    uint64_t position = sizeof(SnapshotHeader) + L * (packed ? sizeof(SnapshotPackedEntry) : sizeof(SnapshotLabelEntry));
+    const uint64_t offsetsSize = (static_cast<uint64_t>(V) + 1) * sizeof(uint32_t);
+    for (uint32_t label = 0; label < L && packed; ++label) {
+        packedDirectory[label].forward = layoutPacked(*forwardIndex[label].packed, position);
+        packedDirectory[label].reverse = layoutPacked(*reverseIndex[label].packed, position);
+    }
+    for (uint32_t label = 0; label < L && !packed; ++label) {
+        auto &entry = directory[label];
+        entry.forwardNoTargets = forwardIndex[label].noTargets;
+        entry.reverseNoTargets = reverseIndex[label].noTargets;
+
+        entry.forwardOffsets = position = alignSection(position);
+        position += offsetsSize;
+        entry.forwardTargets = position = alignSection(position);
+        position += entry.forwardNoTargets * sizeof(uint32_t);
+        entry.reverseOffsets = position = alignSection(position);
+        position += offsetsSize;
+        entry.reverseTargets = position = alignSection(position);
+        position += entry.reverseNoTargets * sizeof(uint32_t);
+    }
+
+    std::ofstream file { fileName, std::ios::binary | std::ios::trunc };
+    if (!file) {
+        throw std::runtime_error("Could not open snapshot file for writing: " + fileName);
+    }
 
-    graphFile.close();
+    uint64_t written = 0;
+    auto writeAt = [&](uint64_t at, const void *bytes, uint64_t size) {
+        static const char padding[SNAPSHOT_ALIGNMENT] = {};
+        while (written < at) {
+            auto n = std::min(at - written, SNAPSHOT_ALIGNMENT);
+            file.write(padding, n);
+            written += n;
+        }
+        file.write(static_cast<const char *>(bytes), size);
+        written += size;
+    };
+    auto writePacked = [&](const SnapshotPackedLists &entry, const PackedLists &lists) {
+        const uint64_t groups = lists.noGroups(), blocks = lists.noValueBlocks();
+        writeAt(entry.words, lists.words, uint64_t(lists.noWords) * sizeof(uint32_t));
+        writeAt(entry.groupPositions, lists.groupPositions, (groups + 1) * sizeof(uint32_t));
+        writeAt(entry.offsetBlocks, lists.offsetBlocks, groups * sizeof(uint32_t));
+        writeAt(entry.offsetWidths, lists.offsetWidths, groups);
+        writeAt(entry.valueBlocks, lists.valueBlocks, blocks * sizeof(uint32_t));
+        writeAt(entry.valueWidths, lists.valueWidths, blocks);
+    };
+
+    writeAt(0, &header, sizeof(header));
+    if (packed) {
+        writeAt(written, packedDirectory.data(), L * sizeof(SnapshotPackedEntry));
+        for (uint32_t label = 0; label < L; ++label) {
+            writePacked(packedDirectory[label].forward, *forwardIndex[label].packed);
+            writePacked(packedDirectory[label].reverse, *reverseIndex[label].packed);
+        }
+    } else {
+        writeAt(written, directory.data(), L * sizeof(SnapshotLabelEntry));
+        for (uint32_t label = 0; label < L; ++label) {
+            const auto &entry = directory[label];
+            writeAt(entry.forwardOffsets, forwardIndex[label].offsets, offsetsSize);
+            writeAt(entry.forwardTargets, forwardIndex[label].targets, entry.forwardNoTargets * sizeof(uint32_t));
+            writeAt(entry.reverseOffsets, reverseIndex[label].offsets, offsetsSize);
+            writeAt(entry.reverseTargets, reverseIndex[label].targets, entry.reverseNoTargets * sizeof(uint32_t));
+        }
+    }
+
+    if (!file) {
+        throw std::runtime_error("Failed writing snapshot file: " + fileName);
+    }
+}
+
+bool SimpleGraph::isSnapshot(const std::string &fileName) {
+    std::ifstream file { fileName, std::ios::binary };
+    char magic[8] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::equal(magic, magic + 8, SNAPSHOT_MAGIC);
+}
+
+// whether the lists of an index are sorted, duplicate-free and within noVertices, and (for a plain index) its
+// offsets ascend from 0 to noTargets; one pass over the index
+static bool isValidIndex(const AdjacencyIndex &index, uint32_t noVertices) {
+    if (index.packed) {
+        const auto &lists = *index.packed;
+        if (lists.offset(0) != 0) return false;
+        for (uint32_t v = 0; v < noVertices; ++v) {
+            if (lists.offset(v) > lists.offset(v + 1)) return false;
+        }
+        if (lists.offset(noVertices) != lists.noValues) return false;
+        PackedReader reader(lists);
+        for (uint32_t v = 0; v < noVertices; ++v) {
+            const auto &neighbours = reader.neighbours(v);
+            for (size_t i = 0; i < neighbours.size(); ++i) {
+                if (neighbours[i] >= noVertices || (i > 0 && neighbours[i] <= neighbours[i - 1])) return false;
+            }
+        }
+        return true;
+    }
+
+    if (index.offsets[0] != 0 || index.offsets[noVertices] != index.noTargets) return false;
+    for (uint32_t v = 0; v < noVertices; ++v) {
+        const uint32_t first = index.offsets[v], last = index.offsets[v + 1];
+        if (first > last) return false;
+        for (uint32_t i = first; i < last; ++i) {
+            if (index.targets[i] >= noVertices || (i > first && index.targets[i] <= index.targets[i - 1])) return false;
+        }
+    }
+    return true;
+}
+
+void SimpleGraph::readFromSnapshot(const std::string &fileName, bool verify) {
+    std::unique_ptr<MappedFile> file(new MappedFile(fileName));
+    const char *base = file->data();
+    const uint64_t size = file->size();
+
+    if (size < sizeof(SnapshotHeader)) {
+        throw std::runtime_error(std::string("Invalid snapshot, file too small!"));
+    }
+    const auto *header = reinterpret_cast<const SnapshotHeader *>(base);
+    if (!std::equal(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 8, header->magic)) {
+        throw std::runtime_error(std::string("Invalid snapshot magic!"));
+    }
+    if (header->version != SNAPSHOT_VERSION && header->version != 1) {
+        throw std::runtime_error("Unsupported snapshot version: " + std::to_string(header->version));
+    }
+    const bool packed = header->version >= 2 && (header->flags & SNAPSHOT_PACKED) != 0;
+    const uint64_t entrySize = packed ? sizeof(SnapshotPackedEntry) : sizeof(SnapshotLabelEntry);
+    if (size < sizeof(SnapshotHeader) + header->noLabels * entrySize) {
+        throw std::runtime_error(std::string("Invalid snapshot, truncated label directory!"));
+    }
+
+    const char *directory = base + sizeof(SnapshotHeader);
+    const uint64_t noOffsets = static_cast<uint64_t>(header->noVertices) + 1;
+
+    // every section has to lie within the file and be aligned for its elements
+    auto bytesAt = [&](uint64_t position, uint64_t bytes, uint64_t alignment) {
+        if (position % alignment != 0 || position > size || bytes > size - position) {
+            throw std::runtime_error(std::string("Invalid snapshot, section out of bounds!"));
+        }
+        return base + position;
+    };
+    auto section = [&](uint64_t position, uint64_t count) {
+        return reinterpret_cast<const uint32_t *>(bytesAt(position, count * sizeof(uint32_t), sizeof(uint32_t)));
+    };
+    auto byteSection = [&](uint64_t position, uint64_t count) {
+        return reinterpret_cast<const uint8_t *>(bytesAt(position, count, 1));
+    };
+    auto packedSection = [&](const SnapshotPackedLists &entry, AdjacencyIndex &index) {
+        auto lists = std::make_shared<PackedLists>();
+        lists->noVertices = header->noVertices;
+        lists->noValues = entry.noValues;
+        lists->noWords = entry.noWords;
+        const uint64_t groups = lists->noGroups(), blocks = lists->noValueBlocks();
+        lists->words = section(entry.words, entry.noWords);
+        lists->groupPositions = section(entry.groupPositions, groups + 1);
+        lists->offsetBlocks = section(entry.offsetBlocks, groups);
+        lists->offsetWidths = byteSection(entry.offsetWidths, groups);
+        lists->valueBlocks = section(entry.valueBlocks, blocks);
+        lists->valueWidths = byteSection(entry.valueWidths, blocks);
+        if (!lists->isConsistent()) {
+            throw std::runtime_error(std::string("Invalid snapshot, packed lists do not match their counts!"));
+        }
+        index.packed = std::move(lists);
+        index.noTargets = entry.noValues;
+    };
+
+    const uint32_t noLabels = header->noLabels;
+    std::vector<AdjacencyIndex> forwardSections(noLabels), reverseSections(noLabels);
+    for (uint32_t label = 0; label < noLabels; ++label) {
+        auto &forward = forwardSections[label];
+        auto &reverse = reverseSections[label];
+        if (packed) {
+            const auto &entry = reinterpret_cast<const SnapshotPackedEntry *>(directory)[label];
+            packedSection(entry.forward, forward);
+            packedSection(entry.reverse, reverse);
+            continue;
+        }
+
+        const auto &entry = reinterpret_cast<const SnapshotLabelEntry *>(directory)[label];
+        forward.offsets = section(entry.forwardOffsets, noOffsets);
+        forward.targets = section(entry.forwardTargets, entry.forwardNoTargets);
+        forward.noTargets = entry.forwardNoTargets;
+        reverse.offsets = section(entry.reverseOffsets, noOffsets);
+        reverse.targets = section(entry.reverseTargets, entry.reverseNoTargets);
+        reverse.noTargets = entry.reverseNoTargets;
+
+        if (forward.offsets[header->noVertices] != forward.noTargets ||
+            reverse.offsets[header->noVertices] != reverse.noTargets) {
+            throw std::runtime_error(std::string("Invalid snapshot, offsets do not match target count!"));
+        }
+    }
+
+    // the checks above keep every section within the file; the lists themselves are read on faith unless verified
+    if (verify) {
+        for (uint32_t label = 0; label < noLabels; ++label) {
+            if (!isValidIndex(forwardSections[label], header->noVertices) ||
+                !isValidIndex(reverseSections[label], header->noVertices)) {
+                throw std::runtime_error("Invalid snapshot, corrupt lists of label " + std::to_string(label) + "!");
+            }
+        }
+    }
+
+    // replace the current graph with the snapshot
+    edgeLists.clear();
+    internalIds.clear();
+    externalIds.clear();
+    L = 0;
+    setNoVertices(header->noVertices);
+    setNoLabels(noLabels);
+    E = header->noEdges;
+    forwardIndex = std::move(forwardSections);
+    reverseIndex = std::move(reverseSections);
+    snapshot = std::move(file);
 
+    // a plain snapshot is packed from the mapping when the graph is to be compressed
+    if (packIndexes && !packed) compressIndexes();
 }
\ No newline at end of file
@@ -0,0 +1,360 @@
+//
+// Vectorized kernels over sorted lists of vertex ids.
+//
+
+#include "SortedSets.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QS_SORTEDSETS_X86 1
+#include <immintrin.h>
+#endif
+
+// scalar kernels, also used for the tails of the vectorized ones
+
+static size_t unionScalar(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    size_t ia = 0, ib = 0, k = 0;
+    while (ia < na && ib < nb) {
+        if (a[ia] < b[ib]) {
+            out[k++] = a[ia++];
+        } else if (b[ib] < a[ia]) {
+            out[k++] = b[ib++];
+        } else {
+            out[k++] = a[ia++];
+            ++ib;
+        }
+    }
+    while (ia < na) out[k++] = a[ia++];
+    while (ib < nb) out[k++] = b[ib++];
+    return k;
+}
+
+static size_t intersectionScalar(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    size_t ia = 0, ib = 0, k = 0;
+    while (ia < na && ib < nb) {
+        if (a[ia] < b[ib]) {
+            ++ia;
+        } else if (b[ib] < a[ia]) {
+            ++ib;
+        } else {
+            out[k++] = a[ia++];
+            ++ib;
+        }
+    }
+    return k;
+}
+
+static size_t dedupScalar(uint32_t *data, size_t n) {
+    return std::unique(data, data + n) - data;
+}
+
+#ifdef QS_SORTEDSETS_X86
+
+// lane permutations that move the kept lanes of a comparison mask to the front
+struct CompressTables {
+    // pshufb byte shuffles for 4 lanes
+    alignas(16) uint8_t sse[16][16];
+    // vpermd lane indices for 8 lanes
+    alignas(32) uint32_t avx[256][8];
+
+    CompressTables() {
+        for (uint32_t mask = 0; mask < 16; ++mask) {
+            uint32_t k = 0;
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                if (!(mask & (1u << lane))) continue;
+                for (uint32_t byte = 0; byte < 4; ++byte) sse[mask][k * 4 + byte] = static_cast<uint8_t>(lane * 4 + byte);
+                ++k;
+            }
+            for (; k < 4; ++k) {
+                for (uint32_t byte = 0; byte < 4; ++byte) sse[mask][k * 4 + byte] = 0x80;
+            }
+        }
+        for (uint32_t mask = 0; mask < 256; ++mask) {
+            uint32_t k = 0;
+            for (uint32_t lane = 0; lane < 8; ++lane) {
+                if (mask & (1u << lane)) avx[mask][k++] = lane;
+            }
+            for (; k < 8; ++k) avx[mask][k] = 0;
+        }
+    }
+};
+
+static const CompressTables &compressTables() {
+    static const CompressTables tables;
+    return tables;
+}
+
+// SSE4.1: 4 lanes
+
+__attribute__((target("sse4.1")))
+static inline __m128i compress4(__m128i v, int mask, const CompressTables &tables) {
+    return _mm_shuffle_epi8(v, _mm_load_si128(reinterpret_cast<const __m128i *>(tables.sse[mask])));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i sortBitonic4(__m128i x) {
+    // distance 2 and 1, keeping the minimum of every pair in its lower lane
+    __m128i y = _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2));
+    x = _mm_blend_epi16(_mm_min_epu32(x, y), _mm_max_epu32(x, y), 0xF0);
+    y = _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_blend_epi16(_mm_min_epu32(x, y), _mm_max_epu32(x, y), 0xCC);
+}
+
+// bitonic merge of two sorted vectors into the lowest (lo) and highest (hi) four values, both sorted
+__attribute__((target("sse4.1")))
+static inline void merge4(__m128i a, __m128i b, __m128i &lo, __m128i &hi) {
+    b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i l = _mm_min_epu32(a, b), h = _mm_max_epu32(a, b);
+    lo = sortBitonic4(l);
+    hi = sortBitonic4(h);
+}
+
+__attribute__((target("sse4.1")))
+static size_t dedupSSE(uint32_t *data, size_t n) {
+    if (n < 8) return dedupScalar(data, n);
+    const auto &tables = compressTables();
+    // the lane before data[0] must differ from it
+    __m128i previous = _mm_set1_epi32(static_cast<int>(data[0] - 1));
+    size_t i = 0, k = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i shifted = _mm_alignr_epi8(v, previous, 12);
+        int keep = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, shifted))) & 0xF;
+        // k <= i, so the store never reaches values that have not been loaded yet
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + k), compress4(v, keep, tables));
+        k += __builtin_popcount(keep);
+        previous = v;
+    }
+    // the stores may have overwritten data[i - 1]
+    uint32_t last = static_cast<uint32_t>(_mm_extract_epi32(previous, 3));
+    for (; i < n; ++i) {
+        if (data[i] != last) data[k++] = data[i];
+        last = data[i];
+    }
+    return k;
+}
+
+__attribute__((target("sse4.1")))
+static size_t unionSSE(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    if (na < 4 || nb < 4) return unionScalar(a, na, b, nb, out);
+
+    // merge four values at a time, then drop the values that occur in both lists
+    __m128i lo, hi;
+    merge4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a)),
+           _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)), lo, hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), lo);
+    size_t ia = 4, ib = 4, k = 4;
+    while (ia + 4 <= na && ib + 4 <= nb) {
+        __m128i next;
+        if (a[ia] < b[ib]) {
+            next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + ia));
+            ia += 4;
+        } else {
+            next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + ib));
+            ib += 4;
+        }
+        merge4(next, hi, lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + k), lo);
+        k += 4;
+    }
+
+    // the four values still held in hi are merged with both tails
+    alignas(16) uint32_t pending[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(pending), hi);
+    uint32_t tail[8];
+    size_t noTail = 0, ip = 0;
+    // at least one list has fewer than 4 values left; those go into the tail, the other list is merged after
+    const bool aShort = na - ia < 4;
+    const uint32_t *other = aShort ? a + ia : b + ib;
+    size_t noOther = aShort ? na - ia : nb - ib;
+    const uint32_t *rest = aShort ? b + ib : a + ia;
+    size_t noRest = aShort ? nb - ib : na - ia;
+    for (size_t io = 0; ip < 4 || io < noOther; ) {
+        if (io == noOther || (ip < 4 && pending[ip] <= other[io])) tail[noTail++] = pending[ip++];
+        else tail[noTail++] = other[io++];
+    }
+    k += unionScalar(tail, noTail, rest, noRest, out + k);
+    return dedupSSE(out, k);
+}
+
+__attribute__((target("sse4.1")))
+static size_t intersectionSSE(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    const auto &tables = compressTables();
+    size_t ia = 0, ib = 0, k = 0;
+    while (ia + 4 <= na && ib + 4 <= nb) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + ia));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + ib));
+        // all-pairs comparison against the rotations of vb
+        __m128i match = _mm_cmpeq_epi32(va, vb);
+        match = _mm_or_si128(match, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        match = _mm_or_si128(match, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        match = _mm_or_si128(match, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(match));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + k), compress4(va, mask, tables));
+        k += __builtin_popcount(mask);
+
+        const uint32_t lastA = a[ia + 3], lastB = b[ib + 3];
+        if (lastA <= lastB) ia += 4;
+        if (lastB <= lastA) ib += 4;
+    }
+    return k + intersectionScalar(a + ia, na - ia, b + ib, nb - ib, out + k);
+}
+
+// AVX2: 8 lanes
+
+__attribute__((target("avx2")))
+static inline __m256i compress8(__m256i v, int mask, const CompressTables &tables) {
+    return _mm256_permutevar8x32_epi32(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(tables.avx[mask])));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i sortBitonic8(__m256i x) {
+    // distance 4, 2 and 1, keeping the minimum of every pair in its lower lane
+    __m256i y = _mm256_permute2x128_si256(x, x, 1);
+    x = _mm256_blend_epi32(_mm256_min_epu32(x, y), _mm256_max_epu32(x, y), 0xF0);
+    y = _mm256_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2));
+    x = _mm256_blend_epi32(_mm256_min_epu32(x, y), _mm256_max_epu32(x, y), 0xCC);
+    y = _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_epi32(_mm256_min_epu32(x, y), _mm256_max_epu32(x, y), 0xAA);
+}
+
+__attribute__((target("avx2")))
+static inline void merge8(__m256i a, __m256i b, __m256i &lo, __m256i &hi) {
+    b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    lo = sortBitonic8(_mm256_min_epu32(a, b));
+    hi = sortBitonic8(_mm256_max_epu32(a, b));
+}
+
+__attribute__((target("avx2")))
+static size_t dedupAVX2(uint32_t *data, size_t n) {
+    if (n < 16) return dedupScalar(data, n);
+    const auto &tables = compressTables();
+    const __m256i rotate = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+    __m256i previous = _mm256_set1_epi32(static_cast<int>(data[0] - 1));
+    size_t i = 0, k = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        // v shifted up by one lane, with the last lane of the previous vector in front
+        __m256i shifted = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(v, rotate),
+                                             _mm256_permutevar8x32_epi32(previous, rotate), 0x01);
+        int keep = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, shifted))) & 0xFF;
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + k), compress8(v, keep, tables));
+        k += __builtin_popcount(keep);
+        previous = v;
+    }
+    uint32_t last = static_cast<uint32_t>(_mm256_extract_epi32(previous, 7));
+    for (; i < n; ++i) {
+        if (data[i] != last) data[k++] = data[i];
+        last = data[i];
+    }
+    return k;
+}
+
+__attribute__((target("avx2")))
+static size_t unionAVX2(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    if (na < 8 || nb < 8) return unionScalar(a, na, b, nb, out);
+
+    __m256i lo, hi;
+    merge8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a)),
+           _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b)), lo, hi);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), lo);
+    size_t ia = 8, ib = 8, k = 8;
+    while (ia + 8 <= na && ib + 8 <= nb) {
+        __m256i next;
+        if (a[ia] < b[ib]) {
+            next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + ia));
+            ia += 8;
+        } else {
+            next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + ib));
+            ib += 8;
+        }
+        merge8(next, hi, lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), lo);
+        k += 8;
+    }
+
+    alignas(32) uint32_t pending[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(pending), hi);
+    uint32_t tail[16];
+    size_t noTail = 0, ip = 0;
+    // at least one list has fewer than 8 values left; those go into the tail, the other list is merged after
+    const bool aShort = na - ia < 8;
+    const uint32_t *other = aShort ? a + ia : b + ib;
+    size_t noOther = aShort ? na - ia : nb - ib;
+    const uint32_t *rest = aShort ? b + ib : a + ia;
+    size_t noRest = aShort ? nb - ib : na - ia;
+    for (size_t io = 0; ip < 8 || io < noOther; ) {
+        if (io == noOther || (ip < 8 && pending[ip] <= other[io])) tail[noTail++] = pending[ip++];
+        else tail[noTail++] = other[io++];
+    }
+    k += unionScalar(tail, noTail, rest, noRest, out + k);
+    return dedupAVX2(out, k);
+}
+
+__attribute__((target("avx2")))
+static size_t intersectionAVX2(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    const auto &tables = compressTables();
+    size_t ia = 0, ib = 0, k = 0;
+    while (ia + 8 <= na && ib + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + ia));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + ib));
+        __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        __m256i match = _mm256_cmpeq_epi32(va, vb);
+        for (int r = 1; r < 8; ++r) {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            match = _mm256_or_si256(match, _mm256_cmpeq_epi32(va, vb));
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(match));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), compress8(va, mask, tables));
+        k += __builtin_popcount(mask);
+
+        const uint32_t lastA = a[ia + 7], lastB = b[ib + 7];
+        if (lastA <= lastB) ia += 8;
+        if (lastB <= lastA) ib += 8;
+    }
+    return k + intersectionScalar(a + ia, na - ia, b + ib, nb - ib, out + k);
+}
+
+#endif // QS_SORTEDSETS_X86
+
+struct SortedSetKernels {
+    size_t (*unite)(const uint32_t *, size_t, const uint32_t *, size_t, uint32_t *);
+    size_t (*intersect)(const uint32_t *, size_t, const uint32_t *, size_t, uint32_t *);
+    size_t (*dedup)(uint32_t *, size_t);
+    const char *name;
+};
+
+static SortedSetKernels selectKernels() {
+#ifdef QS_SORTEDSETS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {unionAVX2, intersectionAVX2, dedupAVX2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return {unionSSE, intersectionSSE, dedupSSE, "sse4.1"};
+    }
+#endif
+    return {unionScalar, intersectionScalar, dedupScalar, "scalar"};
+}
+
+static const SortedSetKernels &kernels() {
+    static const SortedSetKernels selected = selectKernels();
+    return selected;
+}
+
+size_t sortedUnion(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    return kernels().unite(a, na, b, nb, out);
+}
+
+size_t sortedIntersection(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    return kernels().intersect(a, na, b, nb, out);
+}
+
+size_t sortedDedup(uint32_t *data, size_t n) {
+    return kernels().dedup(data, n);
+}
+
+const char *sortedSetKernels() {
+    return kernels().name;
+}
@@ -0,0 +1,143 @@
+//
+// Work-stealing thread pool for fire-and-forget tasks.
+//
+
+#include "WorkStealingPool.h"
+
+// the pool and queue of the worker running on this thread, if any
+static thread_local WorkStealingPool *currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+WorkStealingPool::WorkStealingPool(size_t nWorkers) : noQueued(0), stop(false), nextQueue(0) {
+    nWorkers = std::max<size_t>(1, nWorkers);
+    for (size_t i = 0; i < nWorkers; ++i) {
+        queues.emplace_back(new TaskQueue());
+    }
+    for (size_t i = 0; i < nWorkers; ++i) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stop = true;
+    }
+    idle.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task, std::function<void(std::exception_ptr)> fail) {
+    size_t queue = currentPool == this ? currentQueue : nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        queues[queue]->tasks.push_back({std::move(task), std::move(fail)});
+    }
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        ++noQueued;
+    }
+    idle.notify_one();
+}
+
+void WorkStealingPool::parallelFor(size_t noMorsels, const std::function<void(size_t)> &body) {
+    if (noMorsels <= 1) {
+        if (noMorsels == 1) body(0);
+        return;
+    }
+
+    struct Morsels {
+        std::atomic<size_t> next {0};
+        std::atomic<size_t> noDone {0};
+        std::mutex mutex;
+        std::condition_variable done;
+        // the first exception of body; later morsels are skipped
+        std::exception_ptr error;
+        std::atomic<bool> failed {false};
+    };
+    auto morsels = std::make_shared<Morsels>();
+
+    // helpers that start after every morsel was taken return without touching body
+    const auto *work = &body;
+    auto takeMorsels = [morsels, noMorsels, work]() {
+        for (size_t m = morsels->next++; m < noMorsels; m = morsels->next++) {
+            if (!morsels->failed) {
+                try {
+                    (*work)(m);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(morsels->mutex);
+                    if (!morsels->failed) morsels->error = std::current_exception();
+                    morsels->failed = true;
+                }
+            }
+            if (++morsels->noDone == noMorsels) {
+                std::lock_guard<std::mutex> lock(morsels->mutex);
+                morsels->done.notify_all();
+            }
+        }
+    };
+
+    for (size_t i = 1; i < std::min(noMorsels, workers.size() + 1); ++i) {
+        submit(takeMorsels);
+    }
+    takeMorsels();
+
+    std::unique_lock<std::mutex> lock(morsels->mutex);
+    morsels->done.wait(lock, [&]{ return morsels->noDone == noMorsels; });
+    if (morsels->error != nullptr) {
+        std::rethrow_exception(morsels->error);
+    }
+}
+
+bool WorkStealingPool::pop(size_t self, Task &task) {
+    auto &queue = *queues[self];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t self, Task &task) {
+    for (size_t i = 1; i < queues.size(); ++i) {
+        auto &queue = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t self) {
+    currentPool = this;
+    currentQueue = self;
+
+    Task task;
+    while (true) {
+        if (pop(self, task) || steal(self, task)) {
+            --noQueued;
+            if (task.fail != nullptr) {
+                try {
+                    task.run();
+                } catch (...) {
+                    task.fail(std::current_exception());
+                }
+            } else {
+                task.run();
+            }
+            task = Task();
+            continue;
+        }
+
+        // remaining tasks are still run after stop, so nothing that was submitted is dropped
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idle.wait(lock, [&]{ return stop || noQueued > 0; });
+        if (stop && noQueued == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,379 @@
+//
+// Benchmark suite over generated graphs and queries, reporting its timings as JSON.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <CommandLine.h>
+#include <GraphGenerator.h>
+#include <Json.h>
+#include <SimpleEstimator.h>
+#include <SimpleEvaluator.h>
+
+static const char *const SCENARIOS[] = {"load", "prepare", "estimate", "optimize", "evaluate"};
+
+struct benchOptions {
+    GraphSpec graph;
+    QuerySpec queries;
+    // scenarios to run, in this order: load, prepare, estimate, optimize, evaluate
+    std::vector<std::string> scenarios {std::begin(SCENARIOS), std::end(SCENARIOS)};
+    std::vector<std::string> estimators {"sampling", "markov"};
+    std::string workDir {"."};
+    // the generated workload in the format of the query files, if set
+    std::string queriesFile;
+    uint32_t repeat {3};
+    // queries estimated to produce more paths are not evaluated
+    double maxEstimate {1e7};
+};
+
+// a JSON object whose fields keep their insertion order
+class JsonObject {
+    std::vector<std::pair<std::string, std::string>> fields;
+
+public:
+    void add(const std::string &key, double value) {
+        std::ostringstream out;
+        out.precision(6);
+        out << value;
+        fields.emplace_back(key, out.str());
+    }
+    void add(const std::string &key, uint64_t value) { fields.emplace_back(key, std::to_string(value)); }
+    void add(const std::string &key, uint32_t value) { fields.emplace_back(key, std::to_string(value)); }
+    void add(const std::string &key, const std::string &value) { fields.emplace_back(key, jsonString(value)); }
+    void add(const std::string &key, const JsonObject &value) { fields.emplace_back(key, value.str()); }
+    void add(const std::string &key, const std::vector<double> &values) {
+        std::ostringstream out;
+        out.precision(6);
+        out << '[';
+        for (size_t i = 0; i < values.size(); ++i) out << (i > 0 ? ", " : "") << values[i];
+        out << ']';
+        fields.emplace_back(key, out.str());
+    }
+
+    std::string str(size_t indent = 0) const {
+        std::string pad(indent + 2, ' ');
+        std::string out = "{";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            out += (i > 0 ? ",\n" : "\n") + pad + jsonString(fields[i].first) + ": ";
+            // nested objects are indented along
+            std::string value = fields[i].second;
+            for (size_t p = value.find('\n'); p != std::string::npos; p = value.find('\n', p + 1)) {
+                value.insert(p + 1, std::string(indent + 2, ' '));
+            }
+            out += value;
+        }
+        return out + (fields.empty() ? "}" : "\n" + std::string(indent, ' ') + "}");
+    }
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+// the runs of a scenario, and the per-query latencies of all runs pooled
+static JsonObject summarize(const std::vector<double> &runs, const std::vector<double> &latencies, const std::string &unit) {
+    JsonObject out;
+    out.add("runs_ms", runs);
+    out.add("median_ms", percentile(runs, 0.5));
+    if (!latencies.empty()) {
+        out.add("p50_" + unit, percentile(latencies, 0.5));
+        out.add("p95_" + unit, percentile(latencies, 0.95));
+        out.add("max_" + unit, percentile(latencies, 1.0));
+    }
+    return out;
+}
+
+static std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream in(list);
+    for (std::string item; std::getline(in, item, ',');) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+static bool runs(const benchOptions &opts, const std::string &scenario) {
+    return std::find(opts.scenarios.begin(), opts.scenarios.end(), scenario) != opts.scenarios.end();
+}
+
+// a parsed generated query
+struct benchQuery {
+    std::unique_ptr<RPQTree> tree;
+    uint32_t source;
+    uint32_t target;
+};
+
+// discards everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+// points std::cout at another buffer until restored, at the latest when it goes out of scope, so that an
+// exception does not leave std::cout writing to a buffer that is gone
+class CoutRedirect {
+    std::streambuf *console;
+
+public:
+    explicit CoutRedirect(std::streambuf *buffer) : console(std::cout.rdbuf(buffer)) {}
+    CoutRedirect(const CoutRedirect &) = delete;
+    CoutRedirect &operator=(const CoutRedirect &) = delete;
+    ~CoutRedirect() { restore(); }
+
+    void restore() {
+        if (console != nullptr) std::cout.rdbuf(console);
+        console = nullptr;
+    }
+};
+
+int runBenchmark(benchOptions &opts) {
+    JsonObject report;
+    JsonObject config;
+    config.add("shape", GraphGenerator::shapeName(opts.graph.shape));
+    config.add("vertices", opts.graph.noVertices);
+    config.add("edges", opts.graph.noEdges);
+    config.add("labels", opts.graph.noLabels);
+    config.add("seed", opts.graph.seed);
+    config.add("queries", opts.queries.noQueries);
+    config.add("query_length", std::to_string(opts.queries.minLength) + "-" + std::to_string(opts.queries.maxLength));
+    config.add("repeat", opts.repeat);
+    config.add("threads", static_cast<uint32_t>(std::thread::hardware_concurrency()));
+    report.add("config", config);
+    JsonObject results;
+
+    GraphGenerator generator(opts.graph);
+    auto g = std::make_shared<SimpleGraph>();
+
+    // the graph file is named after its spec, and reused by later runs
+    if (runs(opts, "load")) {
+        const std::string fileName = opts.workDir + "/synthetic-" + GraphGenerator::shapeName(opts.graph.shape) + "-" +
+                                     std::to_string(opts.graph.noVertices) + "-" + std::to_string(opts.graph.noEdges) + "-" +
+                                     std::to_string(opts.graph.noLabels) + "-" + std::to_string(opts.graph.seed) + ".nt";
+        if (!std::ifstream(fileName).good()) {
+            std::cerr << "Writing " << fileName << std::endl;
+            auto start = std::chrono::steady_clock::now();
+            // an interrupted run leaves no partial file behind to be reused
+            generator.writeText(fileName + ".tmp");
+            if (std::rename((fileName + ".tmp").c_str(), fileName.c_str()) != 0) {
+                throw std::runtime_error("Could not rename the generated graph to " + fileName);
+            }
+            JsonObject generate;
+            generate.add("ms", elapsedMs(start));
+            results.add("generate", generate);
+        }
+
+        std::vector<double> loadRuns;
+        for (uint32_t r = 0; r < opts.repeat; ++r) {
+            std::cerr << "Loading the graph (" << r + 1 << "/" << opts.repeat << ")" << std::endl;
+            g = std::make_shared<SimpleGraph>();
+            auto start = std::chrono::steady_clock::now();
+            g->readFromContiguousFile(fileName);
+            loadRuns.push_back(elapsedMs(start));
+        }
+        auto load = summarize(loadRuns, {}, "ms");
+        load.add("edges_per_s", opts.graph.noEdges / (percentile(loadRuns, 0.5) / 1000));
+        load.add("distinct_edges", static_cast<uint64_t>(g->getNoDistinctEdges()));
+        load.add("index_bytes", static_cast<uint64_t>(g->memoryUsage()));
+        results.add("load", load);
+    } else {
+        std::cerr << "Generating the graph" << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        generator.fill(*g);
+        JsonObject generate;
+        generate.add("ms", elapsedMs(start));
+        results.add("generate", generate);
+    }
+
+    std::cerr << "Generating " << opts.queries.noQueries << " queries" << std::endl;
+    std::vector<benchQuery> queries;
+    std::ofstream queriesFile;
+    if (!opts.queriesFile.empty()) queriesFile.open(opts.queriesFile, std::ios::trunc);
+    for (auto query : generateQueries(*g, opts.queries)) {
+        if (queriesFile.is_open()) queriesFile << query.source << ',' << query.path << ',' << query.target << '\n';
+        queries.push_back({std::unique_ptr<RPQTree>(RPQTree::strToTree(query.path)),
+                           parseEndpoint(query.source, *g), parseEndpoint(query.target, *g)});
+    }
+
+    // the engine reports on every query it runs; only the JSON goes to stdout
+    NullBuffer discard;
+    CoutRedirect quiet(&discard);
+
+    JsonObject prepare, estimate, optimize;
+    for (const auto &name : opts.estimators) {
+        std::shared_ptr<SimpleEstimator> est;
+        std::vector<double> prepareRuns;
+        const uint32_t noPrepares = runs(opts, "prepare") ? opts.repeat : 1;
+        for (uint32_t r = 0; r < noPrepares; ++r) {
+            std::cerr << "Preparing the " << name << " estimator (" << r + 1 << "/" << noPrepares << ")" << std::endl;
+            est = makeEstimator(name, g);
+            auto start = std::chrono::steady_clock::now();
+            est->prepare();
+            prepareRuns.push_back(elapsedMs(start));
+        }
+        if (runs(opts, "prepare")) prepare.add(name, summarize(prepareRuns, {}, "ms"));
+
+        if (runs(opts, "estimate")) {
+            std::cerr << "Estimating with the " << name << " estimator" << std::endl;
+            std::vector<double> totals, latencies;
+            for (uint32_t r = 0; r < opts.repeat; ++r) {
+                auto total = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < queries.size(); ++i) {
+                    auto start = std::chrono::steady_clock::now();
+                    est->estimate(queries[i].tree.get(), queries[i].source, queries[i].target);
+                    latencies.push_back(elapsedMs(start) * 1000);
+                }
+                totals.push_back(elapsedMs(total));
+            }
+            estimate.add(name, summarize(totals, latencies, "us"));
+        }
+
+        if (runs(opts, "optimize")) {
+            std::cerr << "Optimizing with the " << name << " estimator" << std::endl;
+            auto ev = std::make_unique<SimpleEvaluator>(g);
+            ev->attachEstimator(est);
+            std::vector<double> totals, latencies;
+            for (uint32_t r = 0; r < opts.repeat; ++r) {
+                auto total = std::chrono::steady_clock::now();
+                for (auto &query : queries) {
+                    query_path path;
+                    ev->unpackQueryTree(&path, query.tree.get());
+                    auto start = std::chrono::steady_clock::now();
+                    delete ev->optimizeQuery(&path, query.source, query.target);
+                    latencies.push_back(elapsedMs(start) * 1000);
+                }
+                totals.push_back(elapsedMs(total));
+            }
+            optimize.add(name, summarize(totals, latencies, "us"));
+        }
+    }
+    if (runs(opts, "prepare")) results.add("prepare", prepare);
+    if (runs(opts, "estimate")) results.add("estimate", estimate);
+    if (runs(opts, "optimize")) results.add("optimize", optimize);
+
+    // every run evaluates on a fresh evaluator, so neither cache carries over between runs
+    if (runs(opts, "evaluate")) {
+        std::vector<double> totals, latencies;
+        std::vector<bool> tooLarge;
+        uint64_t evaluated = 0, skipped = 0, noPaths = 0;
+        for (uint32_t r = 0; r < opts.repeat; ++r) {
+            std::cerr << "Evaluating (" << r + 1 << "/" << opts.repeat << ")" << std::endl;
+            auto est = makeEstimator(opts.estimators.front(), g);
+            auto ev = std::make_unique<SimpleEvaluator>(g);
+            ev->attachEstimator(est);
+            ev->prepare();
+            // the first estimator decides which queries are too large to evaluate, once for all runs
+            for (size_t i = tooLarge.size(); i < queries.size(); ++i) {
+                tooLarge.push_back(est->estimate(queries[i].tree.get(), queries[i].source, queries[i].target).noPaths > opts.maxEstimate);
+            }
+            evaluated = skipped = noPaths = 0;
+            auto total = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < queries.size(); ++i) {
+                if (tooLarge[i]) {
+                    ++skipped;
+                    continue;
+                }
+                auto start = std::chrono::steady_clock::now();
+                auto stat = ev->evaluate(queries[i].tree.get(), queries[i].source, queries[i].target);
+                latencies.push_back(elapsedMs(start));
+                ++evaluated;
+                noPaths += stat.noPaths;
+            }
+            totals.push_back(elapsedMs(total));
+        }
+        auto evaluate = summarize(totals, latencies, "ms");
+        evaluate.add("evaluated", evaluated);
+        evaluate.add("skipped", skipped);
+        // the same for every build of the same spec, unless results change
+        evaluate.add("paths", noPaths);
+        results.add("evaluate", evaluate);
+    }
+
+    quiet.restore();
+    report.add("results", results);
+    std::cout << report.str() << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    benchOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg {argv[i]};
+        auto value = [&arg](size_t length) { return arg.substr(length); };
+        if (arg == "--help") {
+            std::cout << "Usage: quicksilver-bench [--shape=power-law|uniform|hubs] [--vertices=N] [--edges=N] [--labels=N] [--seed=N]"
+                      << " [--queries=N] [--query-length=MIN-MAX] [--scenarios=load,prepare,estimate,optimize,evaluate]"
+                      << " [--estimators=sampling,markov] [--repeat=N] [--max-estimate=PATHS] [--work-dir=DIR] [--write-queries=FILE]" << std::endl;
+            std::cout << "  Generates the graph and the queries deterministically from the seed, and writes the timings as JSON." << std::endl;
+            return 0;
+        } else if (arg.compare(0, 8, "--shape=") == 0) {
+            opts.graph.shape = GraphGenerator::parseShape(value(8));
+        } else if (arg.compare(0, 11, "--vertices=") == 0) {
+            opts.graph.noVertices = static_cast<uint32_t>(std::stoul(value(11)));
+        } else if (arg.compare(0, 8, "--edges=") == 0) {
+            opts.graph.noEdges = std::stoull(value(8));
+        } else if (arg.compare(0, 9, "--labels=") == 0) {
+            opts.graph.noLabels = static_cast<uint32_t>(std::stoul(value(9)));
+        } else if (arg.compare(0, 7, "--seed=") == 0) {
+            opts.graph.seed = opts.queries.seed = std::stoull(value(7));
+        } else if (arg.compare(0, 10, "--queries=") == 0) {
+            opts.queries.noQueries = static_cast<uint32_t>(std::stoul(value(10)));
+        } else if (arg.compare(0, 15, "--query-length=") == 0) {
+            auto lengths = value(15);
+            auto dash = lengths.find('-');
+            opts.queries.minLength = static_cast<uint32_t>(std::stoul(lengths.substr(0, dash)));
+            opts.queries.maxLength = dash == std::string::npos ? opts.queries.minLength
+                                                               : static_cast<uint32_t>(std::stoul(lengths.substr(dash + 1)));
+        } else if (arg.compare(0, 12, "--scenarios=") == 0) {
+            opts.scenarios = splitList(value(12));
+        } else if (arg.compare(0, 13, "--estimators=") == 0) {
+            opts.estimators = splitList(value(13));
+        } else if (arg.compare(0, 9, "--repeat=") == 0) {
+            opts.repeat = std::max<uint32_t>(1, static_cast<uint32_t>(std::stoul(value(9))));
+        } else if (arg.compare(0, 15, "--max-estimate=") == 0) {
+            opts.maxEstimate = std::stod(value(15));
+        } else if (arg.compare(0, 11, "--work-dir=") == 0) {
+            opts.workDir = value(11);
+        } else if (arg.compare(0, 16, "--write-queries=") == 0) {
+            opts.queriesFile = value(16);
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (opts.estimators.empty() || opts.queries.minLength == 0 || opts.queries.minLength > opts.queries.maxLength) {
+        std::cerr << "Need an estimator and query lengths of at least 1" << std::endl;
+        return 1;
+    }
+    for (const auto &name : opts.estimators) {
+        if (!isEstimator(name)) {
+            std::cerr << "Unknown estimator: " << name << std::endl;
+            return 1;
+        }
+    }
+    for (const auto &scenario : opts.scenarios) {
+        if (std::find(std::begin(SCENARIOS), std::end(SCENARIOS), scenario) == std::end(SCENARIOS)) {
+            std::cerr << "Unknown scenario: " << scenario << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        return runBenchmark(opts);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
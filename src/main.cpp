@@ -1,9 +1,14 @@
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <set>
+#include <CommandLine.h>
 #include <SimpleGraph.h>
 #include <Estimator.h>
 #include <SimpleEstimator.h>
 #include <SimpleEvaluator.h>
+#include <MatrixEvaluator.h>
 
 
 struct query {
@@ -16,6 +21,48 @@ struct query {
     }
 };
 
+// command line options of the benchmarks
+struct options {
+    std::string graphFile;
+    std::string queriesFile;
+    std::string snapshotFile;
+    std::string estimator {"sampling"};
+    std::string engine {"hash"};
+    size_t cacheBudget {size_t(1) << 30};
+    bool batch {false};
+    bool semiJoin {false};
+    size_t pathIndexBudget {0};
+    VertexOrder reorder {VertexOrder::input};
+    bool compress {false};
+    // skip the verification of the lists of a snapshot graph file
+    bool trustSnapshot {false};
+    // compare the estimators against exact results instead of timing the evaluator
+    bool estimate {false};
+    // print a table of the operators of every query, and/or write them to a Chrome trace
+    bool profile {false};
+    std::string traceFile;
+    // the options given on the command line, e.g. "--semijoin" or "--cache-budget"
+    std::set<std::string> given;
+};
+
+// the vertex order selected with --reorder=none|degree|bfs|rcm
+VertexOrder parseVertexOrder(const std::string &name) {
+    if (name == "none") return VertexOrder::input;
+    if (name == "degree") return VertexOrder::degree;
+    if (name == "bfs") return VertexOrder::bfs;
+    if (name == "rcm") return VertexOrder::rcm;
+    throw std::runtime_error("Unknown vertex order: " + name);
+}
+
+// a size in MiB as bytes; std::stoull would take "-1" for a huge budget, so the value is parsed as signed
+size_t parseMiB(const std::string &value) {
+    const long long mib = std::stoll(value);
+    if (mib < 0 || static_cast<unsigned long long>(mib) > (SIZE_MAX >> 20)) {
+        throw std::out_of_range("size out of range: " + value);
+    }
+    return static_cast<size_t>(mib) << 20;
+}
+
 std::vector<query> parseQueries(std::string &fileName) {
 
     std::vector<query> queries {};
@@ -45,92 +92,278 @@ std::vector<query> parseQueries(std::string &fileName) {
     return queries;
 }
 
-int estimatorBench(std::string &graphFile, std::string &queriesFile) {
-
-    std::cout << "\n(1) Reading the graph into memory and preparing the estimator...\n" << std::endl;
+// reads a text graph or a binary snapshot of one, and writes a snapshot of the graph if snapshotFile is given;
+// the snapshot keeps the vertex ids of the input and is compressed if the graph is, the graph is reordered afterwards
+bool readGraph(std::shared_ptr<SimpleGraph> &g, options &opts) {
+    auto &graphFile = opts.graphFile;
+    auto &snapshotFile = opts.snapshotFile;
 
-    // read the graph
-    auto g = std::make_shared<SimpleGraph>();
+    // each label is packed as soon as it is built, so the uncompressed graph is never held in full
+    if (opts.compress) g->compressOnBuild();
 
     auto start = std::chrono::steady_clock::now();
     try {
-        g->readFromContiguousFile(graphFile);
+        if (SimpleGraph::isSnapshot(graphFile)) {
+            g->readFromSnapshot(graphFile, !opts.trustSnapshot);
+        } else {
+            g->readFromContiguousFile(graphFile);
+        }
     } catch (std::runtime_error &e) {
         std::cerr << e.what() << std::endl;
-        return 0;
+        return false;
     }
 
     auto end = std::chrono::steady_clock::now();
     std::cout << "Time to read the graph into memory: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
 
-    // prepare the estimator
-    auto est = std::make_unique<SimpleEstimator>(g);
-    start = std::chrono::steady_clock::now();
-    est->prepare();
-    end = std::chrono::steady_clock::now();
-    std::cout << "Time to prepare the estimator: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    if (!snapshotFile.empty()) {
+        start = std::chrono::steady_clock::now();
+        try {
+            g->writeSnapshot(snapshotFile);
+        } catch (std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+        end = std::chrono::steady_clock::now();
+        std::cout << "Time to write the graph snapshot: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    }
 
-    std::cout << "\n(2) Running the query workload..." << std::endl;
+    if (opts.reorder != VertexOrder::input) {
+        start = std::chrono::steady_clock::now();
+        g->reorderVertices(opts.reorder);
+        end = std::chrono::steady_clock::now();
+        std::cout << "Time to reorder the vertices: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    }
 
-    for(auto query : parseQueries(queriesFile)) {
+    if (opts.compress) {
+        std::cout << "Compressed graph indexes: " << g->memoryUsage() / 1024 << " KiB" << std::endl;
+    }
 
-        // perform estimation
-        // parse the query into an AST
-        std::cout << "\nProcessing query: ";
-        query.print();
-        RPQTree *queryTree = RPQTree::strToTree(query.path);
-        std::cout << "Parsed query tree: ";
-        queryTree->print();
+    return true;
+}
+
+// a profiler for the evaluator if --profile or --trace asks for one
+std::shared_ptr<QueryProfiler> makeProfiler(const options &opts) {
+    if (!opts.profile && opts.traceFile.empty()) return nullptr;
+    return std::make_shared<QueryProfiler>();
+}
 
+void reportProfile(const QueryProfiler &profiler, const options &opts) {
+    if (opts.profile) {
+        std::cout << "\nOperators per query:" << std::endl;
+        profiler.printSummary(std::cout);
+    }
+    if (!opts.traceFile.empty()) {
+        std::ofstream trace { opts.traceFile, std::ios::trunc };
+        profiler.writeChromeTrace(trace);
+        if (!trace) {
+            throw std::runtime_error("Could not write the trace file: " + opts.traceFile);
+        }
+        std::cout << "\nWrote the operator trace to " << opts.traceFile << std::endl;
+    }
+}
+
+// q-error of an estimate: how many times it is off, either way; empty results count as one
+double qError(double estimate, double actual) {
+    const double e = std::max(1.0, estimate);
+    const double a = std::max(1.0, actual);
+    return std::max(e / a, a / e);
+}
+
+// nearest-rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    const auto rank = static_cast<size_t>(std::ceil(p / 100 * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+// what one estimator did over the workload
+struct estimatorRun {
+    std::string name;
+    std::shared_ptr<SimpleEstimator> est;
+    double prepareTime {0};
+    size_t memory {0};
+    std::vector<cardStat> estimates;
+    // milliseconds per query
+    std::vector<double> latencies;
+};
+
+// runs every estimator of --estimator (a comma separated list) over the workload, then the exact evaluator, and
+// reports the q-errors of noOut, noPaths and noIn, the estimation latency, and the cost of preparing each estimator
+int estimatorBench(options &opts) {
+
+    std::cout << "\n(1) Reading the graph into memory and preparing the estimators...\n" << std::endl;
+
+    // read the graph
+    auto g = std::make_shared<SimpleGraph>();
+
+    if (!readGraph(g, opts)) {
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto end = start;
+
+    // prepare the estimators
+    std::vector<estimatorRun> runs;
+    std::stringstream names(opts.estimator);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        estimatorRun run;
+        run.name = name;
+        run.est = makeEstimator(name, g);
         start = std::chrono::steady_clock::now();
-        auto estimate = est->estimate(queryTree);
+        run.est->prepare();
         end = std::chrono::steady_clock::now();
+        run.prepareTime = std::chrono::duration<double, std::milli>(end - start).count();
+        run.memory = run.est->memoryUsage();
+        std::cout << "Time to prepare the " << name << " estimator: " << run.prepareTime << " ms ("
+                  << run.memory / 1024 << " KiB)" << std::endl;
+        runs.push_back(std::move(run));
+    }
+    if (runs.empty()) {
+        throw std::runtime_error("No estimator to evaluate");
+    }
 
-        std::cout << "\nEstimation (noOut, noPaths, noIn) : ";
-        estimate.print();
-        std::cout << "Time to estimate: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    // every estimator sees the same queries in the same order, before the evaluator plans with the first one
+    std::cout << "\n(2) Estimating the query workload..." << std::endl;
+
+    auto queries = parseQueries(opts.queriesFile);
+    // parsed up front, so that the latencies are those of the estimates alone
+    std::vector<RPQTree *> trees;
+    std::vector<std::pair<uint32_t, uint32_t>> endpoints;
+    for (auto &query : queries) {
+        trees.push_back(RPQTree::strToTree(query.path));
+        endpoints.emplace_back(parseEndpoint(query.s, *g), parseEndpoint(query.t, *g));
+    }
+    for (auto &run : runs) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            start = std::chrono::steady_clock::now();
+            run.estimates.push_back(run.est->estimate(trees[i], endpoints[i].first, endpoints[i].second));
+            end = std::chrono::steady_clock::now();
+            run.latencies.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+    }
+
+    std::cout << "\n(3) Evaluating the query workload exactly..." << std::endl;
+
+    auto ev = std::make_unique<SimpleEvaluator>(g);
+    // the estimator is prepared already, and the evaluator has nothing else to prepare without a path index
+    ev->attachEstimator(runs.front().est);
+
+    const char *fields[] = {"noOut", "noPaths", "noIn"};
+    // [run][field] -> q-error of every query
+    std::vector<std::vector<std::vector<double>>> qErrors(runs.size(), std::vector<std::vector<double>>(3));
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+
+        std::cout << "\nProcessing query: ";
+        queries[i].print();
 
-        // perform evaluation
-        auto ev = std::make_unique<SimpleEvaluator>(g);
-        ev->prepare();
         start = std::chrono::steady_clock::now();
-        auto actual = ev->evaluate(queryTree);
+        auto actual = ev->evaluate(trees[i], endpoints[i].first, endpoints[i].second);
         end = std::chrono::steady_clock::now();
 
-        std::cout << "Actual (noOut, noPaths, noIn) : ";
+        std::cout << "\nActual (noOut, noPaths, noIn) : ";
         actual.print();
         std::cout << "Time to evaluate: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
 
-        // clean-up
-        delete(queryTree);
+        const double exact[] = {double(actual.noOut), double(actual.noPaths), double(actual.noIn)};
+        for (size_t r = 0; r < runs.size(); ++r) {
+            auto &estimate = runs[r].estimates[i];
+            const double estimated[] = {double(estimate.noOut), double(estimate.noPaths), double(estimate.noIn)};
+            std::cout << "Estimation " << runs[r].name << " (noOut, noPaths, noIn) : (" << estimate.noOut << ", "
+                      << estimate.noPaths << ", " << estimate.noIn << "), q-error (";
+            for (size_t f = 0; f < 3; ++f) {
+                qErrors[r][f].push_back(qError(estimated[f], exact[f]));
+                std::cout << (f > 0 ? ", " : "") << qErrors[r][f].back();
+            }
+            std::cout << "), " << runs[r].latencies[i] << " ms" << std::endl;
+        }
+    }
+
+    // formatted on the side, so that std::cout keeps its own flags
+    std::ostringstream report;
+    report << std::fixed << "\nEstimators over " << queries.size() << " queries:\n";
+    report << std::left << std::setw(12) << "estimator" << std::right << std::setw(13) << "prepare ms" << std::setw(13)
+           << "memory KiB" << std::setw(14) << "mean est. ms" << std::setw(10) << "p50" << std::setw(10) << "p95"
+           << std::setw(10) << "max" << '\n';
+    for (auto &run : runs) {
+        auto latencies = run.latencies;
+        std::sort(latencies.begin(), latencies.end());
+        double total = 0;
+        for (auto latency : latencies) total += latency;
+        report << std::left << std::setw(12) << run.name << std::right << std::setprecision(1)
+               << std::setw(13) << run.prepareTime << std::setw(13) << run.memory / 1024 << std::setprecision(3)
+               << std::setw(14) << (latencies.empty() ? 0 : total / latencies.size())
+               << std::setw(10) << percentile(latencies, 50) << std::setw(10) << percentile(latencies, 95)
+               << std::setw(10) << percentile(latencies, 100) << '\n';
+    }
 
+    report << '\n' << std::left << std::setw(20) << "q-error" << std::right;
+    for (auto p : {"p50", "p90", "p95", "p99", "max"}) report << std::setw(11) << p;
+    report << '\n' << std::setprecision(2);
+    for (size_t r = 0; r < runs.size(); ++r) {
+        for (size_t f = 0; f < 3; ++f) {
+            auto errors = qErrors[r][f];
+            std::sort(errors.begin(), errors.end());
+            report << std::left << std::setw(20) << runs[r].name + " " + fields[f] << std::right;
+            for (auto p : {50.0, 90.0, 95.0, 99.0, 100.0}) report << std::setw(11) << percentile(errors, p);
+            report << '\n';
+        }
+    }
+    std::cout << report.str() << std::flush;
+
+    // clean-up
+    for (auto *tree : trees) {
+        delete(tree);
     }
 
     return 0;
 }
 
-int evaluatorBench(std::string &graphFile, std::string &queriesFile) {
+int evaluatorBench(options &opts) {
+
+    if (opts.engine == "matrix") {
+        // the matrix engine plans without estimates, and has no cache, reduction, path index or profiler
+        for (auto name : {"--estimator", "--cache-budget", "--semijoin", "--path-index", "--profile", "--trace"}) {
+            if (opts.given.count(name) > 0) {
+                throw std::runtime_error(std::string(name) + " is only supported by the hash engine");
+            }
+        }
+    }
 
     std::cout << "\n(1) Reading the graph into memory and preparing the evaluator...\n" << std::endl;
 
     // read the graph
     auto g = std::make_shared<SimpleGraph>();
 
-    auto start = std::chrono::steady_clock::now();
-    try {
-        g->readFromContiguousFile(graphFile);
-    } catch (std::runtime_error &e) {
-        std::cerr << e.what() << std::endl;
+    if (!readGraph(g, opts)) {
         return 0;
     }
 
-    auto end = std::chrono::steady_clock::now();
-    std::cout << "Time to read the graph into memory: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start;
 
     // prepare the evaluator
-    auto est = std::make_shared<SimpleEstimator>(g);
-    auto ev = std::make_unique<SimpleEvaluator>(g);
-    ev->attachEstimator(est);
+    std::unique_ptr<Evaluator> ev;
+    SimpleEvaluator *hashEvaluator = nullptr;
+    auto profiler = makeProfiler(opts);
+    if (opts.engine == "matrix") {
+        ev = std::make_unique<MatrixEvaluator>(g);
+    } else if (opts.engine == "hash") {
+        auto est = makeEstimator(opts.estimator, g);
+        auto simple = std::make_unique<SimpleEvaluator>(g);
+        simple->attachEstimator(est);
+        simple->setCacheBudget(opts.cacheBudget);
+        simple->setSemiJoinReduction(opts.semiJoin);
+        simple->setPathIndexBudget(opts.pathIndexBudget);
+        simple->setProfiler(profiler);
+        hashEvaluator = simple.get();
+        ev = std::move(simple);
+    } else {
+        throw std::runtime_error("Unknown engine: " + opts.engine);
+    }
 
     start = std::chrono::steady_clock::now();
     ev->prepare();
@@ -139,7 +372,7 @@ int evaluatorBench(std::string &graphFile, std::string &queriesFile) {
 
     std::cout << "\n(2) Running the query workload..." << std::endl;
 
-    for(auto query : parseQueries(queriesFile)) {
+    for(auto query : parseQueries(opts.queriesFile)) {
 
         // perform estimation
         // parse the query into an AST
@@ -151,7 +384,7 @@ int evaluatorBench(std::string &graphFile, std::string &queriesFile) {
 
         // perform the evaluation
         start = std::chrono::steady_clock::now();
-        auto actual = ev->evaluate(queryTree);
+        auto actual = ev->evaluate(queryTree, parseEndpoint(query.s, *g), parseEndpoint(query.t, *g));
         end = std::chrono::steady_clock::now();
 
         std::cout << "\nActual (noOut, noPaths, noIn) : ";
@@ -163,26 +396,185 @@ int evaluatorBench(std::string &graphFile, std::string &queriesFile) {
 
     }
 
+    if (hashEvaluator != nullptr) {
+        const auto &cache = hashEvaluator->getCache();
+        std::cout << "\nIntermediate cache: " << cache.hits() << " hits, " << cache.misses() << " misses, "
+                  << cache.size() << " results in " << cache.bytesUsed() / (1 << 20) << " MiB" << std::endl;
+    }
+    if (profiler != nullptr) {
+        reportProfile(*profiler, opts);
+    }
+
     return 0;
 }
 
 
-int main(int argc, char *argv[]) {
+int batchBench(options &opts) {
 
-    if(argc < 3) {
-        std::cout << "Usage: quicksilver <graphFile> <queriesFile>" << std::endl;
+    if (opts.engine != "hash") {
+        throw std::runtime_error("Batch mode is only supported by the hash engine");
+    }
+    if (opts.semiJoin) {
+        // a reduced graph belongs to a single query, while a batch shares its subpaths between queries
+        throw std::runtime_error("Semi-join reduction is not supported in batch mode");
+    }
+
+    std::cout << "\n(1) Reading the graph into memory and preparing the evaluator...\n" << std::endl;
+
+    // read the graph
+    auto g = std::make_shared<SimpleGraph>();
+
+    if (!readGraph(g, opts)) {
         return 0;
     }
 
-    // args
-    std::string graphFile {argv[1]};
-    std::string queriesFile {argv[2]};
+    auto start = std::chrono::steady_clock::now();
+    auto end = start;
 
-//    estimatorBench(graphFile, queriesFile);
-    evaluatorBench(graphFile, queriesFile);
+    // prepare the evaluator
+    auto est = makeEstimator(opts.estimator, g);
+    auto ev = std::make_unique<SimpleEvaluator>(g);
+    ev->attachEstimator(est);
+    ev->setCacheBudget(opts.cacheBudget);
+    ev->setPathIndexBudget(opts.pathIndexBudget);
+    auto profiler = makeProfiler(opts);
+    ev->setProfiler(profiler);
+
+    start = std::chrono::steady_clock::now();
+    ev->prepare();
+    end = std::chrono::steady_clock::now();
+    std::cout << "Time to prepare the evaluator: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+    std::cout << "\n(2) Running the query workload as one batch..." << std::endl;
+
+    auto queries = parseQueries(opts.queriesFile);
+    std::vector<batchQuery> batch;
+    for (auto &query : queries) {
+        batch.push_back({RPQTree::strToTree(query.path), parseEndpoint(query.s, *g), parseEndpoint(query.t, *g)});
+    }
+
+    start = std::chrono::steady_clock::now();
+    auto results = ev->evaluateBatch(batch);
+    end = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        std::cout << "\nProcessing query: ";
+        queries[i].print();
+        std::cout << "Actual (noOut, noPaths, noIn) : ";
+        results[i].print();
+    }
+    std::cout << "\nTime to evaluate the batch: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+    const auto &cache = ev->getCache();
+    std::cout << "Intermediate cache: " << cache.hits() << " hits, " << cache.misses() << " misses, "
+              << cache.size() << " results in " << cache.bytesUsed() / (1 << 20) << " MiB" << std::endl;
+    if (profiler != nullptr) {
+        reportProfile(*profiler, opts);
+    }
+
+    // clean-up
+    for (auto &query : batch) {
+        delete(query.query);
+    }
 
     return 0;
 }
 
 
+void printUsage() {
+    std::cout << "Usage: quicksilver <graphFile> <queriesFile> [snapshotFile] [--estimator=sampling|markov] [--engine=hash|matrix] [--cache-budget=MiB] [--batch] [--semijoin] [--path-index=MiB] [--reorder=none|degree|bfs|rcm] [--compress] [--trust-snapshot] [--profile] [--trace=file] [--estimate]" << std::endl;
+    std::cout << "  graphFile may be a text graph or a snapshot; a snapshot of the graph is written to snapshotFile." << std::endl;
+    std::cout << "  --trust-snapshot skips verifying the lists of a snapshot graphFile, which takes one pass over them." << std::endl;
+    std::cout << "  --profile prints the operators of every query, --trace writes them as Chrome trace events." << std::endl;
+    std::cout << "  --estimate compares the estimators of --estimator (e.g. sampling,markov) with the exact results." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+
+    if(argc < 3) {
+        printUsage();
+        return 0;
+    }
+
+    // args; anything but the options below and a single snapshot path is rejected, rather than taken for the path
+    options opts;
+    opts.graphFile = argv[1];
+    opts.queriesFile = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        std::string arg {argv[i]};
+        if (arg.compare(0, 2, "--") == 0) opts.given.insert(arg.substr(0, arg.find('=')));
+        try {
+            if (arg.compare(0, 12, "--estimator=") == 0) {
+                opts.estimator = arg.substr(12);
+            } else if (arg.compare(0, 9, "--engine=") == 0) {
+                opts.engine = arg.substr(9);
+            } else if (arg == "--batch") {
+                opts.batch = true;
+            } else if (arg == "--semijoin") {
+                opts.semiJoin = true;
+            } else if (arg == "--compress") {
+                opts.compress = true;
+            } else if (arg == "--trust-snapshot") {
+                opts.trustSnapshot = true;
+            } else if (arg == "--estimate") {
+                opts.estimate = true;
+            } else if (arg == "--profile") {
+                opts.profile = true;
+            } else if (arg.compare(0, 8, "--trace=") == 0) {
+                opts.traceFile = arg.substr(8);
+            } else if (arg.compare(0, 15, "--cache-budget=") == 0) {
+                opts.cacheBudget = parseMiB(arg.substr(15));
+            } else if (arg.compare(0, 10, "--reorder=") == 0) {
+                opts.reorder = parseVertexOrder(arg.substr(10));
+            } else if (arg.compare(0, 13, "--path-index=") == 0) {
+                opts.pathIndexBudget = parseMiB(arg.substr(13));
+            } else if (arg.compare(0, 1, "-") == 0) {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage();
+                return 1;
+            } else if (opts.snapshotFile.empty()) {
+                opts.snapshotFile = arg;
+            } else {
+                std::cerr << "Unexpected argument: " << arg << " (the snapshot file is " << opts.snapshotFile << ")" << std::endl;
+                printUsage();
+                return 1;
+            }
+        } catch (std::logic_error &) {
+            // a value that is not a number, or a negative or too large size
+            std::cerr << "Invalid value: " << arg << std::endl;
+            printUsage();
+            return 1;
+        } catch (std::runtime_error &e) {
+            // a vertex order that does not exist, reported before the graph is read
+            std::cerr << e.what() << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    // the estimator comparison evaluates with the plain hash engine, and would drop these without a word
+    if (opts.estimate) {
+        for (auto name : {"--batch", "--engine", "--semijoin", "--path-index", "--cache-budget", "--profile", "--trace"}) {
+            if (opts.given.count(name) > 0) {
+                std::cerr << name << " cannot be combined with --estimate" << std::endl;
+                printUsage();
+                return 1;
+            }
+        }
+    }
+
+    try {
+        if (opts.estimate) {
+            estimatorBench(opts);
+        } else if (opts.batch) {
+            batchBench(opts);
+        } else {
+            evaluatorBench(opts);
+        }
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 
+    return 0;
+}